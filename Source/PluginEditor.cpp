@@ -1,202 +1,299 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin editor.
-
-  ==============================================================================
-*/
-
-#include "PluginProcessor.h"
-#include "PluginEditor.h"
-using namespace juce;
-
-//==============================================================================
-CircularBufferAudioProcessorEditor::CircularBufferAudioProcessorEditor (CircularBufferAudioProcessor& p)
-    : AudioProcessorEditor (&p), audioProcessor (p), delayProcessor (p.getDelay())
-{
-    setSize (600, 400);
-    
-    // *TITLE & SHADOW*
-    //==============================================================================
-    static Typeface::Ptr customWoodFont = Typeface::createSystemTypefaceFor(BinaryData::franknplanklight_ttf, BinaryData::franknplanklight_ttfSize);
-    woodFont = FontOptions(customWoodFont);
-    float titleSize = 47.0f;
-    
-    pluginTitle.setText("Filtered Delay", dontSendNotification);
-    pluginTitle.setFont(FontOptions(woodFont.withHeight(titleSize)));
-    pluginTitle.setColour(Label::textColourId, Colour(92, 61, 33));
-    pluginTitle.setJustificationType(Justification::centred);
-
-    
-    titleShadow.setText("Filtered Delay", dontSendNotification);
-    titleShadow.setFont(FontOptions(woodFont.withHeight(titleSize)));
-    titleShadow.setColour(Label::textColourId, Colour(80, 49, 21));
-    titleShadow.setJustificationType(Justification::centred);
-    
-    // Show shadow first so it appears behind
-    addAndMakeVisible(titleShadow);
-    addAndMakeVisible(pluginTitle);
-
-    
-    // *DECAY TIME SLIDER*
-    //==============================================================================
-    decayTimeSlider.setSliderStyle(Slider::RotaryVerticalDrag);
-    decayTimeSlider.setTextBoxStyle(Slider::NoTextBox, false, 0, 0);
-    decayTimeSlider.setRange(50.0, 10000.0, 1.0);
-    decayTimeSlider.setTextValueSuffix(" ms");
-    decayTimeSlider.setLookAndFeel(&knobLAF);
-    addAndMakeVisible(decayTimeSlider);
-    knobLAF.setLabelForSlider(&decayTimeSlider, "Decay");
-    
-    decayTimeAttach = std::make_unique<AudioProcessorValueTreeState::SliderAttachment>(
-        audioProcessor.treeState, PARAM_DECAY_TIME_MS_ID, decayTimeSlider);
-
-
-    // *DELAY TIME SLIDER*
-    //==============================================================================
-    delayTimeSlider.setSliderStyle(Slider::RotaryVerticalDrag);
-    delayTimeSlider.setTextBoxStyle(Slider::NoTextBox, false, 0, 0);
-    delayTimeSlider.setRange(10.0, 2000.0, 1.0);
-    delayTimeSlider.setTextValueSuffix(" ms");
-    delayTimeSlider.setLookAndFeel(&knobLAF);
-    addAndMakeVisible(delayTimeSlider);
-    knobLAF.setLabelForSlider(&delayTimeSlider, "Delay");
-    
-    delayTimeAttach = std::make_unique<AudioProcessorValueTreeState::SliderAttachment>(
-        audioProcessor.treeState, PARAM_DELAY_TIME_ID, delayTimeSlider);
-    
-    // *HIPASS TIME SLIDER*
-    //==============================================================================
-    hipassSlider.setSliderStyle(Slider::RotaryVerticalDrag);
-    hipassSlider.setTextBoxStyle(Slider::NoTextBox, false, 0, 0);
-    hipassSlider.setRange(20.0, 10000.0, 1.0);
-    hipassSlider.setTextValueSuffix(" Hz");
-    hipassSlider.setLookAndFeel(&knobLAF);
-    addAndMakeVisible(hipassSlider);
-    knobLAF.setLabelForSlider(&hipassSlider, "HiPass");
-    
-    hipassAttach = std::make_unique<AudioProcessorValueTreeState::SliderAttachment>(
-        audioProcessor.treeState, PARAM_HP_CUTOFF_ID, hipassSlider);
-    
-    // *HIPASS TIME SLIDER*
-    //==============================================================================
-    lowpassSlider.setSliderStyle(Slider::RotaryVerticalDrag);
-    lowpassSlider.setTextBoxStyle(Slider::NoTextBox, false, 0, 0);
-    lowpassSlider.setRange(25.0, 20000.0, 1.0);
-    lowpassSlider.setTextValueSuffix(" Hz");
-    lowpassSlider.setLookAndFeel(&knobLAF);
-    addAndMakeVisible(lowpassSlider);
-    knobLAF.setLabelForSlider(&lowpassSlider, "LoPass");
-    
-    lowpassAttach = std::make_unique<AudioProcessorValueTreeState::SliderAttachment>(
-        audioProcessor.treeState, PARAM_LP_CUTOFF_ID, lowpassSlider);
-    
-    // *DRY SLIDER*
-    //==============================================================================
-    drySlider.setSliderStyle(Slider::LinearVertical);
-    drySlider.setTextBoxStyle(Slider::TextBoxBelow, false, 80, 20);
-    drySlider.setRange(10.0, 2000.0, 1.0);
-    drySlider.setTextValueSuffix("%");
-    drySlider.setLookAndFeel(&knobLAF);
-    addAndMakeVisible(drySlider);
-    
-    dryLabel.setText("Dry", dontSendNotification);
-    dryLabel.setJustificationType(Justification::centred);
-    addAndMakeVisible(dryLabel);
-    
-    dryAttach = std::make_unique<AudioProcessorValueTreeState::SliderAttachment>(
-        audioProcessor.treeState, PARAM_DRY_ID, drySlider);
-    
-    // *WET SLIDER*
-    //==============================================================================
-    wetSlider.setSliderStyle(Slider::LinearVertical);
-    wetSlider.setTextBoxStyle(Slider::TextBoxBelow, false, 80, 20);
-    wetSlider.setRange(10.0, 2000.0, 1.0);
-    wetSlider.setTextValueSuffix("%");
-    wetSlider.setLookAndFeel(&knobLAF);
-    addAndMakeVisible(wetSlider);
-    
-    wetLabel.setText("Wet", dontSendNotification);
-    wetLabel.setJustificationType(Justification::centred);
-    addAndMakeVisible(wetLabel);
-    
-    wetAttach = std::make_unique<AudioProcessorValueTreeState::SliderAttachment>(
-        audioProcessor.treeState, PARAM_WET_ID, wetSlider);
-}
-
-CircularBufferAudioProcessorEditor::~CircularBufferAudioProcessorEditor()
-{
-    decayTimeAttach.reset();
-    delayTimeAttach.reset();
-    hipassAttach.reset();
-    lowpassAttach.reset();
-    dryAttach.reset();
-    wetAttach.reset();
-    
-    decayTimeSlider.setLookAndFeel(nullptr);
-    delayTimeSlider.setLookAndFeel(nullptr);
-}
-
-//==============================================================================
-void CircularBufferAudioProcessorEditor::paint (Graphics& g)
-{
-    g.fillAll (knobLAF.getBackgroundColour());
-}
-
-void CircularBufferAudioProcessorEditor::resized()
-{
-    // Plugin UI Size
-    auto bounds = getLocalBounds();
-    
-    
-    // Layout constants
-    const int margin = 15;               // outer margin
-    const int innerMargin = 10;          // spacing inside right/left panels
-    const int rightPanelWidth = getWidth() / 4; // rightmost quarter
-
-    
-    // --- Rightmost quarter panel bounds (ie: Area for Wet/Dry Sliders) ---
-    auto rightPanel = bounds.removeFromRight(rightPanelWidth)
-                            .removeFromTop(3 * (getHeight()/4))
-                            .reduced(margin);
-
-    // Split the right panel into two equal columns for both Dry and Wet
-    auto dryArea = rightPanel.removeFromLeft(rightPanel.getWidth() / 2).reduced(innerMargin);
-    auto wetArea = rightPanel.reduced(innerMargin);
-
-    drySlider.setBounds(dryArea);
-    wetSlider.setBounds(wetArea);
-
-    
-    // Labels below the sliders:
-    const int labelHeight = 18;
-    dryLabel.setBounds(dryArea.withTop(dryArea.getBottom() + 4)
-                               .withHeight(labelHeight));
-    wetLabel.setBounds(wetArea.withTop(wetArea.getBottom() + 4)
-                               .withHeight(labelHeight));
-
-    // Left side rotary knobs
-    auto leftSide = bounds.reduced(margin);
-    auto knobSpacing = 20.0f;
-    auto columnSpacing = -20.0f;
-
-    const int knobSize = std::min(leftSide.getWidth() / 3, leftSide.getHeight() / 3);
-    auto knobColumn = leftSide.removeFromRight(knobSize).reduced(margin);
-
-    auto decayArea = knobColumn.removeFromTop(knobSize).withSizeKeepingCentre(knobSize, knobSize);
-    auto delayArea = knobColumn.removeFromTop(knobSize + knobSpacing).withSizeKeepingCentre(knobSize, knobSize);
-
-    decayTimeSlider.setBounds(decayArea);
-    delayTimeSlider.setBounds(delayArea);
-    
-    auto secondKnobColumn = leftSide.removeFromRight(knobSize).translated(columnSpacing, 0).reduced(margin);
-    auto hipassArea = secondKnobColumn.removeFromTop(knobSize).withSizeKeepingCentre(knobSize, knobSize);
-    auto lowpassArea = secondKnobColumn.removeFromTop(knobSize + knobSpacing).withSizeKeepingCentre(knobSize, knobSize);
-    
-    hipassSlider.setBounds(hipassArea);
-    lowpassSlider.setBounds(lowpassArea);
-    
-    auto shadowOffset = 1.0f;
-    titleShadow.setBounds(margin, margin, hipassSlider.getX() - innerMargin, getHeight()/3);
-    pluginTitle.setBounds(titleShadow.getX() - shadowOffset, titleShadow.getY() - shadowOffset, titleShadow.getWidth(), titleShadow.getHeight());
-}
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin editor.
+
+  ==============================================================================
+*/
+
+#include "PluginProcessor.h"
+#include "PluginEditor.h"
+using namespace juce;
+
+//==============================================================================
+CircularBufferAudioProcessorEditor::CircularBufferAudioProcessorEditor (CircularBufferAudioProcessor& p)
+    : AudioProcessorEditor (&p), audioProcessor (p), delayProcessor (p.getDelay())
+{
+    setSize (600, 400 + controlsHeight);
+    
+    // *TITLE & SHADOW*
+    //==============================================================================
+    static Typeface::Ptr customWoodFont = Typeface::createSystemTypefaceFor(BinaryData::franknplanklight_ttf, BinaryData::franknplanklight_ttfSize);
+    woodFont = FontOptions(customWoodFont);
+    float titleSize = 47.0f;
+    
+    pluginTitle.setText("Filtered Delay", dontSendNotification);
+    pluginTitle.setFont(FontOptions(woodFont.withHeight(titleSize)));
+    pluginTitle.setColour(Label::textColourId, Colour(92, 61, 33));
+    pluginTitle.setJustificationType(Justification::centred);
+
+    
+    titleShadow.setText("Filtered Delay", dontSendNotification);
+    titleShadow.setFont(FontOptions(woodFont.withHeight(titleSize)));
+    titleShadow.setColour(Label::textColourId, Colour(80, 49, 21));
+    titleShadow.setJustificationType(Justification::centred);
+    
+    // Show shadow first so it appears behind
+    addAndMakeVisible(titleShadow);
+    addAndMakeVisible(pluginTitle);
+
+    
+    // *DECAY TIME SLIDER*
+    //==============================================================================
+    decayTimeSlider.setSliderStyle(Slider::RotaryVerticalDrag);
+    decayTimeSlider.setTextBoxStyle(Slider::NoTextBox, false, 0, 0);
+    decayTimeSlider.setRange(50.0, 10000.0, 1.0);
+    decayTimeSlider.setTextValueSuffix(" ms");
+    decayTimeSlider.setLookAndFeel(&knobLAF);
+    addAndMakeVisible(decayTimeSlider);
+    knobLAF.setLabelForSlider(&decayTimeSlider, "Decay");
+    
+    decayTimeAttach = std::make_unique<AudioProcessorValueTreeState::SliderAttachment>(
+        audioProcessor.treeState, PARAM_DECAY_TIME_MS_ID, decayTimeSlider);
+
+
+    // *DELAY TIME SLIDER*
+    //==============================================================================
+    delayTimeSlider.setSliderStyle(Slider::RotaryVerticalDrag);
+    delayTimeSlider.setTextBoxStyle(Slider::NoTextBox, false, 0, 0);
+    delayTimeSlider.setRange(10.0, 2000.0, 1.0);
+    delayTimeSlider.setTextValueSuffix(" ms");
+    delayTimeSlider.setLookAndFeel(&knobLAF);
+    addAndMakeVisible(delayTimeSlider);
+    knobLAF.setLabelForSlider(&delayTimeSlider, "Delay");
+    
+    delayTimeAttach = std::make_unique<AudioProcessorValueTreeState::SliderAttachment>(
+        audioProcessor.treeState, PARAM_DELAY_TIME_ID, delayTimeSlider);
+    
+    // *HIPASS TIME SLIDER*
+    //==============================================================================
+    hipassSlider.setSliderStyle(Slider::RotaryVerticalDrag);
+    hipassSlider.setTextBoxStyle(Slider::NoTextBox, false, 0, 0);
+    hipassSlider.setRange(20.0, 10000.0, 1.0);
+    hipassSlider.setTextValueSuffix(" Hz");
+    hipassSlider.setLookAndFeel(&knobLAF);
+    addAndMakeVisible(hipassSlider);
+    knobLAF.setLabelForSlider(&hipassSlider, "HiPass");
+    
+    hipassAttach = std::make_unique<AudioProcessorValueTreeState::SliderAttachment>(
+        audioProcessor.treeState, PARAM_HP_CUTOFF_ID, hipassSlider);
+    
+    // *HIPASS TIME SLIDER*
+    //==============================================================================
+    lowpassSlider.setSliderStyle(Slider::RotaryVerticalDrag);
+    lowpassSlider.setTextBoxStyle(Slider::NoTextBox, false, 0, 0);
+    lowpassSlider.setRange(25.0, 20000.0, 1.0);
+    lowpassSlider.setTextValueSuffix(" Hz");
+    lowpassSlider.setLookAndFeel(&knobLAF);
+    addAndMakeVisible(lowpassSlider);
+    knobLAF.setLabelForSlider(&lowpassSlider, "LoPass");
+    
+    lowpassAttach = std::make_unique<AudioProcessorValueTreeState::SliderAttachment>(
+        audioProcessor.treeState, PARAM_LP_CUTOFF_ID, lowpassSlider);
+    
+    // *DRY SLIDER*
+    //==============================================================================
+    drySlider.setSliderStyle(Slider::LinearVertical);
+    drySlider.setTextBoxStyle(Slider::TextBoxBelow, false, 80, 20);
+    drySlider.setRange(10.0, 2000.0, 1.0);
+    drySlider.setTextValueSuffix("%");
+    drySlider.setLookAndFeel(&knobLAF);
+    addAndMakeVisible(drySlider);
+    
+    dryLabel.setText("Dry", dontSendNotification);
+    dryLabel.setJustificationType(Justification::centred);
+    addAndMakeVisible(dryLabel);
+    
+    dryAttach = std::make_unique<AudioProcessorValueTreeState::SliderAttachment>(
+        audioProcessor.treeState, PARAM_DRY_ID, drySlider);
+    
+    // *WET SLIDER*
+    //==============================================================================
+    wetSlider.setSliderStyle(Slider::LinearVertical);
+    wetSlider.setTextBoxStyle(Slider::TextBoxBelow, false, 80, 20);
+    wetSlider.setRange(10.0, 2000.0, 1.0);
+    wetSlider.setTextValueSuffix("%");
+    wetSlider.setLookAndFeel(&knobLAF);
+    addAndMakeVisible(wetSlider);
+    
+    wetLabel.setText("Wet", dontSendNotification);
+    wetLabel.setJustificationType(Justification::centred);
+    addAndMakeVisible(wetLabel);
+    
+    wetAttach = std::make_unique<AudioProcessorValueTreeState::SliderAttachment>(
+        audioProcessor.treeState, PARAM_WET_ID, wetSlider);
+    
+    // *BOTTOM PANEL*
+    //==============================================================================
+    addSmallKnob(shimmerSlider, PARAM_SHIMMER_ID, "Shimmer", "%");
+    addSmallKnob(pingPongSlider, PARAM_PING_PONG_ID, "Ping-Pong", "%");
+    addSmallKnob(widthSlider, PARAM_WIDTH_ID, "Width", "%");
+    addSmallKnob(rotationSlider, PARAM_ROTATION_ID, "Rotation", " deg");
+    addSmallKnob(duckSlider, PARAM_DUCK_ID, "Duck", "%");
+    addSmallKnob(duckAttackSlider, PARAM_DUCK_ATTACK_ID, "Attack", " ms");
+    addSmallKnob(duckReleaseSlider, PARAM_DUCK_RELEASE_ID, "Release", " ms");
+    addSmallKnob(sideDelayTimeSlider, PARAM_SIDE_DELAY_TIME_ID, "Side Delay", " ms");
+    addSmallKnob(sideDecayTimeSlider, PARAM_SIDE_DECAY_TIME_MS_ID, "Side Decay", " ms");
+    addSmallKnob(sideHipassSlider, PARAM_SIDE_HP_CUTOFF_ID, "Side HP", " Hz");
+    addSmallKnob(sideLowpassSlider, PARAM_SIDE_LP_CUTOFF_ID, "Side LP", " Hz");
+    addSmallKnob(tapeStopTimeSlider, PARAM_TAPE_STOP_TIME_ID, "Tape Time", " ms");
+    
+    addToggle(syncButton, PARAM_SYNC_ID, "Sync");
+    addToggle(freezeButton, PARAM_FREEZE_ID, "Freeze");
+    addToggle(midSideButton, PARAM_MID_SIDE_ID, "Mid/Side");
+    addToggle(reverseButton, PARAM_REVERSE_ID, "Reverse");
+    addToggle(tapeStopButton, PARAM_TAPE_STOP_ID, "Tape Stop");
+    
+    addChoiceBox(shimmerPitchBox, shimmerPitchLabel, PARAM_SHIMMER_PITCH_ID, "Pitch");
+    addChoiceBox(syncDivisionBox, syncDivisionLabel, PARAM_SYNC_DIVISION_ID, "Division");
+    addChoiceBox(syncModeBox, syncModeLabel, PARAM_SYNC_MODE_ID, "Sync Mode");
+    addChoiceBox(storageBox, storageLabel, PARAM_STORAGE_ID, "Storage");
+    addChoiceBox(duckModeBox, duckModeLabel, PARAM_DUCK_MODE_ID, "Detector");
+}
+
+void CircularBufferAudioProcessorEditor::addSmallKnob (Slider& slider, const String& paramID, const String& labelText, const String& suffix)
+{
+    slider.setSliderStyle(Slider::RotaryVerticalDrag);
+    slider.setTextBoxStyle(Slider::NoTextBox, false, 0, 0);
+    slider.setTextValueSuffix(suffix);
+    slider.setLookAndFeel(&knobLAF);
+    addAndMakeVisible(slider);
+    knobLAF.setLabelForSlider(&slider, labelText);
+    panelKnobs.add(&slider);
+    
+    knobAttachments.add(new AudioProcessorValueTreeState::SliderAttachment(audioProcessor.treeState, paramID, slider));
+}
+
+void CircularBufferAudioProcessorEditor::addToggle (ToggleButton& button, const String& paramID, const String& buttonText)
+{
+    button.setButtonText(buttonText);
+    button.setLookAndFeel(&knobLAF);
+    addAndMakeVisible(button);
+    panelToggles.add(&button);
+    
+    buttonAttachments.add(new AudioProcessorValueTreeState::ButtonAttachment(audioProcessor.treeState, paramID, button));
+}
+
+void CircularBufferAudioProcessorEditor::addChoiceBox (ComboBox& box, Label& label, const String& paramID, const String& labelText)
+{
+    // The items have to be in place before the attachment selects one
+    if (auto* choice = dynamic_cast<AudioParameterChoice*>(audioProcessor.treeState.getParameter(paramID)))
+        box.addItemList(choice->choices, 1);
+    
+    box.setLookAndFeel(&knobLAF);
+    addAndMakeVisible(box);
+    panelBoxes.add(&box);
+    
+    label.setText(labelText, dontSendNotification);
+    label.setJustificationType(Justification::centred);
+    label.attachToComponent(&box, false);
+    
+    boxAttachments.add(new AudioProcessorValueTreeState::ComboBoxAttachment(audioProcessor.treeState, paramID, box));
+}
+
+CircularBufferAudioProcessorEditor::~CircularBufferAudioProcessorEditor()
+{
+    decayTimeAttach.reset();
+    delayTimeAttach.reset();
+    hipassAttach.reset();
+    lowpassAttach.reset();
+    dryAttach.reset();
+    wetAttach.reset();
+    knobAttachments.clear();
+    buttonAttachments.clear();
+    boxAttachments.clear();
+    
+    // knobLAF goes before the components do, so none of them may still point at it
+    for (auto* child : getChildren())
+        child->setLookAndFeel(nullptr);
+}
+
+//==============================================================================
+void CircularBufferAudioProcessorEditor::paint (Graphics& g)
+{
+    g.fillAll (knobLAF.getBackgroundColour());
+}
+
+void CircularBufferAudioProcessorEditor::resized()
+{
+    // Plugin UI Size: the main controls on top, the bottom panel below
+    auto bounds = getLocalBounds();
+    auto controls = bounds.removeFromBottom(controlsHeight);
+    const int mainHeight = bounds.getHeight();
+    
+    
+    // Layout constants
+    const int margin = 15;               // outer margin
+    const int innerMargin = 10;          // spacing inside right/left panels
+    const int rightPanelWidth = bounds.getWidth() / 4; // rightmost quarter
+
+    
+    // --- Rightmost quarter panel bounds (ie: Area for Wet/Dry Sliders) ---
+    auto rightPanel = bounds.removeFromRight(rightPanelWidth)
+                            .removeFromTop(3 * (mainHeight/4))
+                            .reduced(margin);
+
+    // Split the right panel into two equal columns for both Dry and Wet
+    auto dryArea = rightPanel.removeFromLeft(rightPanel.getWidth() / 2).reduced(innerMargin);
+    auto wetArea = rightPanel.reduced(innerMargin);
+
+    drySlider.setBounds(dryArea);
+    wetSlider.setBounds(wetArea);
+
+    
+    // Labels below the sliders:
+    const int labelHeight = 18;
+    dryLabel.setBounds(dryArea.withTop(dryArea.getBottom() + 4)
+                               .withHeight(labelHeight));
+    wetLabel.setBounds(wetArea.withTop(wetArea.getBottom() + 4)
+                               .withHeight(labelHeight));
+
+    // Left side rotary knobs
+    auto leftSide = bounds.reduced(margin);
+    auto knobSpacing = 20.0f;
+    auto columnSpacing = -20.0f;
+
+    const int knobSize = std::min(leftSide.getWidth() / 3, leftSide.getHeight() / 3);
+    auto knobColumn = leftSide.removeFromRight(knobSize).reduced(margin);
+
+    auto decayArea = knobColumn.removeFromTop(knobSize).withSizeKeepingCentre(knobSize, knobSize);
+    auto delayArea = knobColumn.removeFromTop(knobSize + knobSpacing).withSizeKeepingCentre(knobSize, knobSize);
+
+    decayTimeSlider.setBounds(decayArea);
+    delayTimeSlider.setBounds(delayArea);
+    
+    auto secondKnobColumn = leftSide.removeFromRight(knobSize).translated(columnSpacing, 0).reduced(margin);
+    auto hipassArea = secondKnobColumn.removeFromTop(knobSize).withSizeKeepingCentre(knobSize, knobSize);
+    auto lowpassArea = secondKnobColumn.removeFromTop(knobSize + knobSpacing).withSizeKeepingCentre(knobSize, knobSize);
+    
+    hipassSlider.setBounds(hipassArea);
+    lowpassSlider.setBounds(lowpassArea);
+    
+    auto shadowOffset = 1.0f;
+    titleShadow.setBounds(margin, margin, hipassSlider.getX() - innerMargin, mainHeight/3);
+    pluginTitle.setBounds(titleShadow.getX() - shadowOffset, titleShadow.getY() - shadowOffset, titleShadow.getWidth(), titleShadow.getHeight());
+    
+    // Bottom panel: rows of small knobs, then the switches, then the choice boxes (labels sit above them)
+    auto panel = controls.reduced(margin, 0);
+    const int rowHeight = 30;
+    const int boxLabelHeight = 20;
+    const int knobsPerRow = 6;
+    const int smallKnobSize = panel.getWidth() / knobsPerRow;
+    const int cellWidth = panel.getWidth() / 5;
+    
+    for (int first = 0; first < panelKnobs.size(); first += knobsPerRow)
+    {
+        auto rowArea = panel.removeFromTop(smallKnobSize);
+        for (int i = first; i < jmin(first + knobsPerRow, panelKnobs.size()); ++i)
+            panelKnobs[i]->setBounds(rowArea.removeFromLeft(smallKnobSize).reduced(4));
+    }
+    
+    auto switchArea = panel.removeFromTop(rowHeight);
+    for (auto* button : panelToggles)
+        button->setBounds(switchArea.removeFromLeft(cellWidth).reduced(innerMargin, 2));
+    
+    panel.removeFromTop(boxLabelHeight);
+    auto boxArea = panel.removeFromTop(rowHeight);
+    for (auto* box : panelBoxes)
+        box->setBounds(boxArea.removeFromLeft(cellWidth).reduced(4, 2));
+}
@@ -1,406 +1,1551 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin processor.
-
-  ==============================================================================
-*/
-
-#include "PluginProcessor.h"
-#include "PluginEditor.h"
-using namespace juce;
-
-//==============================================================================
-
-CircularBufferAudioProcessor::CircularBufferAudioProcessor()
-#ifndef JucePlugin_PreferredChannelConfigurations
-     : AudioProcessor (BusesProperties()
-                     #if ! JucePlugin_IsMidiEffect
-                      #if ! JucePlugin_IsSynth
-                       .withInput  ("Input",  AudioChannelSet::stereo(), true)
-                      #endif
-                       .withOutput ("Output", AudioChannelSet::stereo(), true)
-                     #endif
-                       ),
-        treeState(*this, nullptr, "PARAMS", createParameterLayout())
-#endif
-{
-    treeState.state = ValueTree("saveParams");
-}
-
-AudioProcessorValueTreeState::ParameterLayout CircularBufferAudioProcessor::createParameterLayout()
-{
-    std::vector<std::unique_ptr<RangedAudioParameter>> params;
-
-    // Delay time (10.0ms to 2000.0ms)
-    params.push_back (std::make_unique<AudioParameterFloat>(PARAM_DELAY_TIME_ID,
-                                                            "Delay Time (ms)",
-                                                            NormalisableRange<float>(10.0f, 2000.0f, 1.0f, 1.0f), 200.0f));
-
-    // Decay time to -60 dB (in ms)
-    params.push_back(std::make_unique<AudioParameterFloat>(PARAM_DECAY_TIME_MS_ID,
-                                                           "Decay (ms, to -60 dB)",
-                                                           NormalisableRange<float>(50.0f, 10000.0f, 1.0f, 1.0f), 2000.0f));
-
-
-    // Wet & Dry (0% to 100%)
-    params.push_back (std::make_unique<AudioParameterFloat>(PARAM_WET_ID,
-                                                            "Wet",
-                                                            NormalisableRange<float>(0.0f, 100.0f, 1.0f), 35.0f));
-
-    params.push_back (std::make_unique<AudioParameterFloat>(PARAM_DRY_ID,
-                                                            "Dry",
-                                                            NormalisableRange<float>(0.0f, 100.0f, 1.0f), 100.0f));
-
-    // Hi & Low Pass Filters (HP: 0HZ to 10,000Hz, LP: 25HZ to 20,000Hz)
-    params.push_back (std::make_unique<AudioParameterFloat>(PARAM_HP_CUTOFF_ID, "High-Pass (Hz)",
-        NormalisableRange<float>(0.0f, 10000.0f, 1.0f, 0.5f), 0.0f));
-    
-    params.push_back (std::make_unique<AudioParameterFloat>(PARAM_LP_CUTOFF_ID, "Low-Pass (Hz)",
-        NormalisableRange<float>(25.0f, 20000.0f, 1.0f, 0.5f), 20000.0f));
-
-    return { params.begin(), params.end() };
-}
-
-
-CircularBufferAudioProcessor::~CircularBufferAudioProcessor()
-{
-}
-
-//==============================================================================
-const String CircularBufferAudioProcessor::getName() const
-{
-    return JucePlugin_Name;
-}
-
-bool CircularBufferAudioProcessor::acceptsMidi() const
-{
-   #if JucePlugin_WantsMidiInput
-    return true;
-   #else
-    return false;
-   #endif
-}
-
-bool CircularBufferAudioProcessor::producesMidi() const
-{
-   #if JucePlugin_ProducesMidiOutput
-    return true;
-   #else
-    return false;
-   #endif
-}
-
-bool CircularBufferAudioProcessor::isMidiEffect() const
-{
-   #if JucePlugin_IsMidiEffect
-    return true;
-   #else
-    return false;
-   #endif
-}
-
-
-double CircularBufferAudioProcessor::getTailLengthSeconds() const
-{
-    const float f = delay.getFeedback();
-    const float T = delay.getDelayTime();
-
-    if (f <= 0.0f || T <= 0.0f) return 0.0;
-
-    const double k = std::log(0.001) / std::log(std::max(0.0001f, f)); // safety
-    return T * k;
-}
-
-
-int CircularBufferAudioProcessor::getNumPrograms()
-{
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
-}
-
-int CircularBufferAudioProcessor::getCurrentProgram()
-{
-    return 0;
-}
-
-void CircularBufferAudioProcessor::setCurrentProgram (int index)
-{
-}
-
-const String CircularBufferAudioProcessor::getProgramName (int index)
-{
-    return {};
-}
-
-void CircularBufferAudioProcessor::changeProgramName (int index, const String& newName)
-{
-}
-
-//==============================================================================
-void DelayEffect::prepare (double sr, int channels, float maxDelayTime)
-{
-    sampleRate = sr;
-    const int delaySamples = (int)(maxDelayTime * sr);
-    delayBuffer.setSize(channels, delaySamples);
-    delayBuffer.clear();
-    
-    writePosition = 0;
-    
-    
-    // Prepare filters per channel
-    hpFilters.resize(channels);
-    lpFilters.resize(channels);
-
-    dsp::ProcessSpec spec;
-    spec.sampleRate = sampleRate;
-    spec.maximumBlockSize = (uint32) 512;
-    spec.numChannels = (uint32) channels;
-
-    for (int ch = 0; ch < channels; ++ch)
-    {
-        hpFilters[ch].reset();
-        lpFilters[ch].reset();
-        hpFilters[ch].prepare(spec);
-        lpFilters[ch].prepare(spec);
-
-        hpFilters[ch].coefficients = dsp::IIR::Coefficients<float>::makeHighPass(sampleRate, hpCutoff);
-        lpFilters[ch].coefficients = dsp::IIR::Coefficients<float>::makeLowPass(sampleRate, lpCutoff);
-
-    }
-    filtersPrepared = true;
-}
-
-void DelayEffect::setDelayTime (float delayTime)
-{
-    // delayTime from user will be in ms. Convert to seconds while calculating delayInSamples:
-    delayInSamples = (int)(delayTime * 0.001f * sampleRate);
-    delayInSamples = jlimit (1, delayBuffer.getNumSamples() - 1, delayInSamples);
-}
-
-void DelayEffect::setFeedback (float feedbackAmount)
-{
-    feedback = jlimit (0.0f, 0.995f, feedbackAmount);
-}
-
-
-void DelayEffect::setWet (float wetAmount)
-{
-    // wetAmount will be in range 1.0 to 100.0. Convert to fit in range 0.0 to 1.0:
-    wet = jlimit(0.0f, 1.0f, wetAmount / 100.0f);
-}
-
-void DelayEffect::setDry (float dryAmount)
-{
-    // dryAmount will be in range 1.0 to 100.0. Convert to fit in range 0.0 to 1.0:
-    dry = jlimit(0.0f, 1.0f, dryAmount / 100.0f);
-}
-
-
-void DelayEffect::setHighPassCutoff(float hpHz)
-{
-    hpCutoff = jlimit(20.0f, 10000.0f, hpHz);
-    if (!filtersPrepared || sampleRate <= 0.0) return;
-
-    auto newCoeffs = dsp::IIR::Coefficients<float>::makeHighPass(sampleRate, hpCutoff);
-    
-    for (auto& hp : hpFilters)
-        hp.coefficients = newCoeffs;
-}
-
-void DelayEffect::setLowPassCutoff(float lpHz)
-{
-    lpCutoff = jlimit(25.0f, 20000.0f, lpHz);
-    if (!filtersPrepared || sampleRate <= 0.0) return;
-
-
-    auto newCoeffs = dsp::IIR::Coefficients<float>::makeLowPass(sampleRate, lpCutoff);
-    for (auto& lp : lpFilters)
-        lp.coefficients = newCoeffs;
-
-}
-
-void DelayEffect::clear()
-{
-    delayBuffer.clear();
-    writePosition = 0;
-}
-
-
-void DelayEffect::process (AudioBuffer<float>& buffer)
-{
-    const int numSamples      = buffer.getNumSamples();
-    const int numChannels     = buffer.getNumChannels();
-    const int delayBufferSize = delayBuffer.getNumSamples();
-
-    for (int channel = 0; channel < numChannels; ++channel)
-    {
-        auto* outData   = buffer.getWritePointer(channel);
-        auto* delayData = delayBuffer.getWritePointer(channel);
-
-        int localWritePos = writePosition;
-
-        // Handle delay sample by sample
-        for (int i = 0; i < numSamples; ++i)
-        {
-            const int readPos = (localWritePos - delayInSamples + delayBufferSize) % delayBufferSize;
-
-            const float in   = outData[i];       // host-provided input
-            const float dly  = delayData[readPos];
-        
-            float dlyWet = dly;
-            
-            if (filtersPrepared)
-            {
-                dlyWet = hpFilters[channel].processSample(dlyWet);
-                dlyWet = lpFilters[channel].processSample(dlyWet);
-            }
-
-            const float out  = dry * in + wet * dlyWet;
-            outData[i]       = out;
-
-            float fb = dlyWet * feedback;
-            
-            // Process the feedback through HP and LP (per channel)
-            if (filtersPrepared)
-            {
-                fb = hpFilters[channel].processSample(fb);
-                fb = lpFilters[channel].processSample(fb);
-            }
-
-            // Write back: input + filtered feedback
-            delayData[localWritePos] = in + fb;
-
-
-            if (++localWritePos >= delayBufferSize)
-                localWritePos = 0;
-        }
-    }
-
-    writePosition += numSamples;
-    writePosition %= delayBuffer.getNumSamples();
-}
-
-
-void CircularBufferAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
-{
-    ignoreUnused(samplesPerBlock);
-
-    delay.prepare(sampleRate, getTotalNumOutputChannels(), 2.0f); // 2 s max delay
-
-    readAPVTS();
-}
-
-void CircularBufferAudioProcessor::releaseResources()
-{
-    delay.clear();
-}
-
-#ifndef JucePlugin_PreferredChannelConfigurations
-bool CircularBufferAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
-{
-  #if JucePlugin_IsMidiEffect
-    ignoreUnused (layouts);
-    return true;
-  #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != AudioChannelSet::stereo())
-        return false;
-
-    // This checks if the input layout matches the output layout
-   #if ! JucePlugin_IsSynth
-    if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
-        return false;
-   #endif
-
-    return true;
-  #endif
-}
-#endif
-
-void CircularBufferAudioProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer& midiMessages)
-{
-    ScopedNoDenormals noDenormals;
-    
-    auto totalNumInputChannels  = getTotalNumInputChannels();
-    auto totalNumOutputChannels = getTotalNumOutputChannels();
-
-    for (int ch = totalNumInputChannels; ch < totalNumOutputChannels; ++ch)
-        buffer.clear (ch, 0, buffer.getNumSamples());
-
-    readAPVTS();
-    delay.process (buffer);
-}
-
-void CircularBufferAudioProcessor::readAPVTS()
-{
-    // 1) Read delay time (ms) and set it
-    const float delayMs = *treeState.getRawParameterValue(PARAM_DELAY_TIME_ID);
-    delay.setDelayTime(delayMs);
-    
-    // 2) Read decay time (ms)
-    const float decayMs = *treeState.getRawParameterValue(PARAM_DECAY_TIME_MS_ID);
-
-    // Protect against edge cases
-    const float T = delay.getDelayTime();
-    const float D = std::max(0.001f, decayMs * 0.001f);
-
-    // Compute linear feedback f so that the tail reaches -60 dB in D seconds:
-    // Using: f = 0.001^(T / D) = 10^(-3 * T / D)
-    float f = std::pow(0.001f, T / D);
-
-    // Match previous limits
-    f = jlimit(0.0f, 0.995f, f);
-
-    delay.setFeedback(f);
-
-    // Wet & Dry parameters:
-    delay.setWet(*treeState.getRawParameterValue(PARAM_WET_ID));
-    delay.setDry(*treeState.getRawParameterValue(PARAM_DRY_ID));
-    
-    // Hi & Low pass parameters:
-    delay.setHighPassCutoff(*treeState.getRawParameterValue(PARAM_HP_CUTOFF_ID));
-    delay.setLowPassCutoff(*treeState.getRawParameterValue(PARAM_LP_CUTOFF_ID));
-}
-
-//==============================================================================
-bool CircularBufferAudioProcessor::hasEditor() const
-{
-    return true; // (change this to false if you choose to not supply an editor)
-}
-
-AudioProcessorEditor* CircularBufferAudioProcessor::createEditor()
-{
-    return new CircularBufferAudioProcessorEditor (*this);
-}
-
-//==============================================================================
-void CircularBufferAudioProcessor::getStateInformation (MemoryBlock& destData)
-{
-    std::unique_ptr<XmlElement> xml(treeState.state.createXml());
-    copyXmlToBinary(*xml, destData);
-}
-
-void CircularBufferAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
-{
-    std::unique_ptr<XmlElement> theParams(getXmlFromBinary(data, sizeInBytes));
-    if (theParams != nullptr)
-    {
-        // If xml has name "saveParams"
-        if(theParams -> hasTagName(treeState.state.getType()))
-        {
-            treeState.state = ValueTree::fromXml(*theParams);
-        }
-    }
-}
-
-//==============================================================================
-// This creates new instances of the plugin..
-AudioProcessor* JUCE_CALLTYPE createPluginFilter()
-{
-    return new CircularBufferAudioProcessor();
-}
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin processor.
+
+  ==============================================================================
+*/
+
+#include "PluginProcessor.h"
+#include "PluginEditor.h"
+using namespace juce;
+
+namespace
+{
+    // 16-bit delay line format: full scale is +12 dBFS so the feedback has room to build up
+    constexpr float compactHeadroom = 4.0f;
+    constexpr float compactToFloat  = compactHeadroom / 32767.0f;
+    constexpr float floatToCompact  = 32767.0f / compactHeadroom;
+
+    inline float loadSample (float sample) noexcept  { return sample; }
+    inline float loadSample (int16 sample) noexcept  { return (float) sample * compactToFloat; }
+
+    inline void storeSample (float& dest, float sample) noexcept  { dest = sample; }
+    // Truncates toward zero: rounding to nearest lets a quiet tail settle into a limit cycle,
+    // recirculating the same few LSBs forever, where truncation always lets it die out
+    inline void storeSample (int16& dest, float sample) noexcept
+    {
+        dest = (int16) jlimit (-32767.0f, 32767.0f, sample * floatToCompact);
+    }
+
+    void packRun (const float* src, int16* dest, int numSamples) noexcept
+    {
+        for (int i = 0; i < numSamples; ++i)
+            storeSample (dest[i], src[i]);
+    }
+
+    void unpackRun (const int16* src, float* dest, int numSamples) noexcept
+    {
+        for (int i = 0; i < numSamples; ++i)
+            dest[i] = loadSample (src[i]);
+    }
+
+    // A run of the line seen as floats: the float line is used in place, the 16-bit one goes through
+    // scratch, converted in one go when the run is read (readRun) or written back (commitRun)
+    inline const float* readRun (const float* line, float*, int) noexcept  { return line; }
+    inline const float* readRun (const int16* line, float* scratch, int numSamples) noexcept
+    {
+        unpackRun (line, scratch, numSamples);
+        return scratch;
+    }
+
+    inline float* writeRun (float* line, float*) noexcept     { return line; }
+    inline float* writeRun (int16*, float* scratch) noexcept  { return scratch; }
+
+    inline void commitRun (float*, const float*, int) noexcept  {}
+    inline void commitRun (int16* line, const float* run, int numSamples) noexcept
+    {
+        packRun (run, line, numSamples);
+    }
+}
+
+//==============================================================================
+
+CircularBufferAudioProcessor::CircularBufferAudioProcessor()
+#ifndef JucePlugin_PreferredChannelConfigurations
+     : AudioProcessor (BusesProperties()
+                     #if ! JucePlugin_IsMidiEffect
+                      #if ! JucePlugin_IsSynth
+                       .withInput  ("Input",  AudioChannelSet::stereo(), true)
+                       .withInput  ("Sidechain", AudioChannelSet::stereo(), false)
+                      #endif
+                       .withOutput ("Output", AudioChannelSet::stereo(), true)
+                     #endif
+                       ),
+        treeState(*this, nullptr, "PARAMS", createParameterLayout())
+#endif
+{
+    treeState.state = ValueTree("saveParams");
+    treeState.addParameterListener(PARAM_STORAGE_ID, this);
+}
+
+AudioProcessorValueTreeState::ParameterLayout CircularBufferAudioProcessor::createParameterLayout()
+{
+    std::vector<std::unique_ptr<RangedAudioParameter>> params;
+
+    // Delay time (10.0ms to 2000.0ms)
+    params.push_back (std::make_unique<AudioParameterFloat>(PARAM_DELAY_TIME_ID,
+                                                            "Delay Time (ms)",
+                                                            NormalisableRange<float>(10.0f, 2000.0f, 1.0f, 1.0f), 200.0f));
+
+    // Decay time to -60 dB (in ms)
+    params.push_back(std::make_unique<AudioParameterFloat>(PARAM_DECAY_TIME_MS_ID,
+                                                           "Decay (ms, to -60 dB)",
+                                                           NormalisableRange<float>(50.0f, 10000.0f, 1.0f, 1.0f), 2000.0f));
+
+
+    // Wet & Dry (0% to 100%)
+    params.push_back (std::make_unique<AudioParameterFloat>(PARAM_WET_ID,
+                                                            "Wet",
+                                                            NormalisableRange<float>(0.0f, 100.0f, 1.0f), 35.0f));
+
+    params.push_back (std::make_unique<AudioParameterFloat>(PARAM_DRY_ID,
+                                                            "Dry",
+                                                            NormalisableRange<float>(0.0f, 100.0f, 1.0f), 100.0f));
+
+    // Hi & Low Pass Filters (HP: 0HZ to 10,000Hz, LP: 25HZ to 20,000Hz)
+    params.push_back (std::make_unique<AudioParameterFloat>(PARAM_HP_CUTOFF_ID, "High-Pass (Hz)",
+        NormalisableRange<float>(0.0f, 10000.0f, 1.0f, 0.5f), 0.0f));
+    
+    params.push_back (std::make_unique<AudioParameterFloat>(PARAM_LP_CUTOFF_ID, "Low-Pass (Hz)",
+        NormalisableRange<float>(25.0f, 20000.0f, 1.0f, 0.5f), 20000.0f));
+
+    // Shimmer amount (0% to 100%) & interval of the pitch-shifted feedback
+    params.push_back (std::make_unique<AudioParameterFloat>(PARAM_SHIMMER_ID,
+                                                            "Shimmer",
+                                                            NormalisableRange<float>(0.0f, 100.0f, 1.0f), 0.0f));
+
+    params.push_back (std::make_unique<AudioParameterChoice>(PARAM_SHIMMER_PITCH_ID,
+                                                             "Shimmer Pitch",
+                                                             StringArray { "-12 st", "-7 st", "+7 st", "+12 st" }, 3));
+
+    // Tempo sync: replaces the free delay time by a note division of the host tempo
+    params.push_back (std::make_unique<AudioParameterBool>(PARAM_SYNC_ID, "Tempo Sync", false));
+
+    params.push_back (std::make_unique<AudioParameterChoice>(PARAM_SYNC_DIVISION_ID,
+                                                             "Sync Division",
+                                                             StringArray { "1/1", "1/2", "1/4", "1/8", "1/16", "1/32" }, 2));
+
+    params.push_back (std::make_unique<AudioParameterChoice>(PARAM_SYNC_MODE_ID,
+                                                             "Sync Mode",
+                                                             StringArray { "Straight", "Dotted", "Triplet" }, 0));
+
+    // Stereo feedback: ping-pong (0% to 100%), wet width (0% to 100%), feedback rotation (-90 to 90 degrees)
+    params.push_back (std::make_unique<AudioParameterFloat>(PARAM_PING_PONG_ID,
+                                                            "Ping-Pong",
+                                                            NormalisableRange<float>(0.0f, 100.0f, 1.0f), 0.0f));
+
+    params.push_back (std::make_unique<AudioParameterFloat>(PARAM_WIDTH_ID,
+                                                            "Width",
+                                                            NormalisableRange<float>(0.0f, 100.0f, 1.0f), 100.0f));
+
+    params.push_back (std::make_unique<AudioParameterFloat>(PARAM_ROTATION_ID,
+                                                            "Rotation",
+                                                            NormalisableRange<float>(-90.0f, 90.0f, 1.0f), 0.0f));
+
+    // Delay line storage format (16-bit takes half the memory)
+    params.push_back (std::make_unique<AudioParameterChoice>(PARAM_STORAGE_ID,
+                                                             "Storage",
+                                                             StringArray { "32-bit Float", "16-bit" }, 0));
+
+    // Ducking: depth (0% to 100%), attack (0.1ms to 100ms), release (10ms to 2000ms), peak or RMS detector
+    params.push_back (std::make_unique<AudioParameterFloat>(PARAM_DUCK_ID,
+                                                            "Duck",
+                                                            NormalisableRange<float>(0.0f, 100.0f, 1.0f), 0.0f));
+
+    params.push_back (std::make_unique<AudioParameterFloat>(PARAM_DUCK_ATTACK_ID,
+                                                            "Duck Attack (ms)",
+                                                            NormalisableRange<float>(0.1f, 100.0f, 0.1f, 0.5f), 10.0f));
+
+    params.push_back (std::make_unique<AudioParameterFloat>(PARAM_DUCK_RELEASE_ID,
+                                                            "Duck Release (ms)",
+                                                            NormalisableRange<float>(10.0f, 2000.0f, 1.0f, 0.5f), 250.0f));
+
+    params.push_back (std::make_unique<AudioParameterChoice>(PARAM_DUCK_MODE_ID,
+                                                             "Duck Detector",
+                                                             StringArray { "Peak", "RMS" }, 0));
+
+    // Mid/side: the side channel gets its own delay time, decay and filters
+    params.push_back (std::make_unique<AudioParameterBool>(PARAM_MID_SIDE_ID, "Mid/Side", false));
+
+    params.push_back (std::make_unique<AudioParameterFloat>(PARAM_SIDE_DELAY_TIME_ID,
+                                                            "Side Delay Time (ms)",
+                                                            NormalisableRange<float>(10.0f, 2000.0f, 1.0f, 1.0f), 300.0f));
+
+    params.push_back(std::make_unique<AudioParameterFloat>(PARAM_SIDE_DECAY_TIME_MS_ID,
+                                                           "Side Decay (ms, to -60 dB)",
+                                                           NormalisableRange<float>(50.0f, 10000.0f, 1.0f, 1.0f), 2000.0f));
+
+    params.push_back (std::make_unique<AudioParameterFloat>(PARAM_SIDE_HP_CUTOFF_ID, "Side High-Pass (Hz)",
+        NormalisableRange<float>(0.0f, 10000.0f, 1.0f, 0.5f), 0.0f));
+
+    params.push_back (std::make_unique<AudioParameterFloat>(PARAM_SIDE_LP_CUTOFF_ID, "Side Low-Pass (Hz)",
+        NormalisableRange<float>(25.0f, 20000.0f, 1.0f, 0.5f), 20000.0f));
+
+    // Reverse & tape stop playback of the delay line
+    params.push_back (std::make_unique<AudioParameterBool>(PARAM_REVERSE_ID, "Reverse", false));
+
+    params.push_back (std::make_unique<AudioParameterBool>(PARAM_TAPE_STOP_ID, "Tape Stop", false));
+
+    params.push_back (std::make_unique<AudioParameterFloat>(PARAM_TAPE_STOP_TIME_ID,
+                                                            "Tape Stop Time (ms)",
+                                                            NormalisableRange<float>(50.0f, 5000.0f, 1.0f, 0.5f), 1000.0f));
+
+    // Freeze: hold the current repeats forever
+    params.push_back (std::make_unique<AudioParameterBool>(PARAM_FREEZE_ID, "Freeze", false));
+
+    return { params.begin(), params.end() };
+}
+
+
+CircularBufferAudioProcessor::~CircularBufferAudioProcessor()
+{
+    treeState.removeParameterListener(PARAM_STORAGE_ID, this);
+    cancelPendingUpdate();
+}
+
+//==============================================================================
+const String CircularBufferAudioProcessor::getName() const
+{
+    return JucePlugin_Name;
+}
+
+bool CircularBufferAudioProcessor::acceptsMidi() const
+{
+   #if JucePlugin_WantsMidiInput
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+bool CircularBufferAudioProcessor::producesMidi() const
+{
+   #if JucePlugin_ProducesMidiOutput
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+bool CircularBufferAudioProcessor::isMidiEffect() const
+{
+   #if JucePlugin_IsMidiEffect
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+
+double CircularBufferAudioProcessor::getTailLengthSeconds() const
+{
+    // Computed on the audio thread by readAPVTS(), hosts may ask from any thread
+    return tailLengthSeconds.load();
+}
+
+
+int CircularBufferAudioProcessor::getNumPrograms()
+{
+    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
+                // so this should be at least 1, even if you're not really implementing programs.
+}
+
+int CircularBufferAudioProcessor::getCurrentProgram()
+{
+    return 0;
+}
+
+void CircularBufferAudioProcessor::setCurrentProgram (int index)
+{
+}
+
+const String CircularBufferAudioProcessor::getProgramName (int index)
+{
+    return {};
+}
+
+void CircularBufferAudioProcessor::changeProgramName (int index, const String& newName)
+{
+}
+
+//==============================================================================
+void DelayEffect::prepare (double sr, int channels, float maxDelayTime)
+{
+    sampleRate = sr;
+    jassert (channels <= maxChannels);
+    lineChannels = channels;
+    lineLength   = (int)(maxDelayTime * sr);
+    
+    // Only the active storage format is allocated
+    if (compactStorage)
+    {
+        delayBuffer.setSize(0, 0);
+        compactBuffer.allocate((size_t) lineChannels * (size_t) lineLength, true);
+    }
+    else
+    {
+        compactBuffer.free();
+        delayBuffer.setSize(lineChannels, lineLength);
+        delayBuffer.clear();
+    }
+    
+    writePosition = 0;
+    
+    
+    // Prepare filters per channel
+    hpFilters.resize(channels);
+    lpFilters.resize(channels);
+
+    dsp::ProcessSpec spec;
+    spec.sampleRate = sampleRate;
+    spec.maximumBlockSize = (uint32) 512;
+    spec.numChannels = (uint32) channels;
+
+    for (int ch = 0; ch < channels; ++ch)
+    {
+        hpFilters[ch].reset();
+        lpFilters[ch].reset();
+        hpFilters[ch].prepare(spec);
+        lpFilters[ch].prepare(spec);
+
+        hpFilters[ch].coefficients = dsp::IIR::Coefficients<float>::makeHighPass(sampleRate, isSideChannel(ch) ? sideHpCutoff : hpCutoff);
+        lpFilters[ch].coefficients = dsp::IIR::Coefficients<float>::makeLowPass(sampleRate, isSideChannel(ch) ? sideLpCutoff : lpCutoff);
+
+    }
+    filtersPrepared = true;
+    
+    // Grains of 50 ms, windowed by sin^2 so that two heads half a grain apart always sum to 1
+    grainSize  = (float)(0.05 * sr);
+    grainPhase = 0.0f;
+    
+    reversePosition = {};
+    previousReversePosition = {};
+    tapeSpeed = 1.0f;
+    tapeLag   = 0.0f;
+    
+    // A freeze doesn't survive: the loop it was playing is gone, and it may not fit the new line.
+    // If freeze is still on, process() engages it again on the new line
+    frozen        = false;
+    freezeLength  = 0;
+    freezePhase   = 0;
+    freezeBlend   = 0;
+    
+    windowTable.resize(windowTableSize);
+    for (int i = 0; i < windowTableSize; ++i)
+        windowTable[i] = square(std::sin(MathConstants<float>::pi * (float) i / (float) windowTableSize));
+    
+    // Retime crossfades over 50 ms: retimeTable[i] is the fade-in gain, read backwards for the fade-out
+    retimeLength = jmax(1, (int)(0.05 * sr));
+    retimeTable.resize(retimeLength);
+    for (int i = 0; i < retimeLength; ++i)
+        retimeTable[i] = std::sin(MathConstants<float>::halfPi * (float)(i + 1) / (float) retimeLength);
+    
+    // Nothing to fade from yet: the first delay time is applied straight away
+    delayInSamples = previousDelayInSamples = targetDelayInSamples = 0;
+    sideDelayInSamples = sidePreviousDelayInSamples = sideTargetDelayInSamples = 0;
+    retimePosition = retimeLength;
+    
+    updateFeedbackMatrix();
+}
+
+void DelayEffect::setDelayTime (float delayTime)
+{
+    // delayTime from user will be in ms. Convert to seconds while calculating delayInSamples:
+    // The new value is only picked up by process(), once any running crossfade has finished.
+    targetDelayInSamples = (int)(delayTime * 0.001f * sampleRate);
+    targetDelayInSamples = jlimit (1, lineLength - 1, targetDelayInSamples);
+}
+
+void DelayEffect::setFeedback (float feedbackAmount)
+{
+    feedback = jlimit (0.0f, 0.995f, feedbackAmount);
+}
+
+
+void DelayEffect::setWet (float wetAmount)
+{
+    // wetAmount will be in range 1.0 to 100.0. Convert to fit in range 0.0 to 1.0:
+    wet = jlimit(0.0f, 1.0f, wetAmount / 100.0f);
+}
+
+void DelayEffect::setDry (float dryAmount)
+{
+    // dryAmount will be in range 1.0 to 100.0. Convert to fit in range 0.0 to 1.0:
+    dry = jlimit(0.0f, 1.0f, dryAmount / 100.0f);
+}
+
+
+void DelayEffect::setHighPassCutoff(float hpHz)
+{
+    hpCutoff = jlimit(20.0f, 10000.0f, hpHz);
+    if (!filtersPrepared || sampleRate <= 0.0) return;
+
+    auto newCoeffs = dsp::IIR::Coefficients<float>::makeHighPass(sampleRate, hpCutoff);
+    
+    for (size_t ch = 0; ch < hpFilters.size(); ++ch)
+        if (! isSideChannel((int) ch))
+            hpFilters[ch].coefficients = newCoeffs;
+}
+
+void DelayEffect::setLowPassCutoff(float lpHz)
+{
+    lpCutoff = jlimit(25.0f, 20000.0f, lpHz);
+    if (!filtersPrepared || sampleRate <= 0.0) return;
+
+
+    auto newCoeffs = dsp::IIR::Coefficients<float>::makeLowPass(sampleRate, lpCutoff);
+    for (size_t ch = 0; ch < lpFilters.size(); ++ch)
+        if (! isSideChannel((int) ch))
+            lpFilters[ch].coefficients = newCoeffs;
+
+}
+
+void DelayEffect::setMidSide (bool shouldUseMidSide)
+{
+    if (midSide == shouldUseMidSide)
+        return;
+
+    midSide = shouldUseMidSide;
+    updateFeedbackMatrix();
+    
+    // The line holds left/right in one mode and mid/side in the other: re-encode what is already
+    // in it, so the repeats in flight keep their stereo image
+    if (lineChannels == 2)
+    {
+        if (compactStorage)
+            transcodeLine(compactBuffer.get(), compactBuffer.get() + lineLength);
+        else
+            transcodeLine(delayBuffer.getWritePointer(0), delayBuffer.getWritePointer(1));
+    }
+    
+    // Channel 1 switches between the main and the side filter settings
+    if (filtersPrepared && lineChannels == 2)
+    {
+        hpFilters[1].coefficients = dsp::IIR::Coefficients<float>::makeHighPass(sampleRate, midSide ? sideHpCutoff : hpCutoff);
+        lpFilters[1].coefficients = dsp::IIR::Coefficients<float>::makeLowPass(sampleRate, midSide ? sideLpCutoff : lpCutoff);
+    }
+}
+
+void DelayEffect::setSideDelayTime (float delayTime)
+{
+    // Same as setDelayTime(), for the side channel of the mid/side mode
+    sideTargetDelayInSamples = (int)(delayTime * 0.001f * sampleRate);
+    sideTargetDelayInSamples = jlimit (1, lineLength - 1, sideTargetDelayInSamples);
+}
+
+void DelayEffect::setSideFeedback (float feedbackAmount)
+{
+    sideFeedback = jlimit (0.0f, 0.995f, feedbackAmount);
+}
+
+void DelayEffect::setSideHighPassCutoff (float hpHz)
+{
+    // Called every block: only make new coefficients when the cutoff actually moved.
+    // setMidSide() and prepare() install them from sideHpCutoff whenever the side lane comes into use
+    const float newCutoff = jlimit(20.0f, 10000.0f, hpHz);
+    if (newCutoff == sideHpCutoff)
+        return;
+
+    sideHpCutoff = newCutoff;
+    if (!filtersPrepared || sampleRate <= 0.0 || ! isSideChannel(1)) return;
+
+    hpFilters[1].coefficients = dsp::IIR::Coefficients<float>::makeHighPass(sampleRate, sideHpCutoff);
+}
+
+void DelayEffect::setSideLowPassCutoff (float lpHz)
+{
+    // As setSideHighPassCutoff()
+    const float newCutoff = jlimit(25.0f, 20000.0f, lpHz);
+    if (newCutoff == sideLpCutoff)
+        return;
+
+    sideLpCutoff = newCutoff;
+    if (!filtersPrepared || sampleRate <= 0.0 || ! isSideChannel(1)) return;
+
+    lpFilters[1].coefficients = dsp::IIR::Coefficients<float>::makeLowPass(sampleRate, sideLpCutoff);
+}
+
+void DelayEffect::setShimmer (float shimmerAmount)
+{
+    // shimmerAmount will be in range 0.0 to 100.0. Convert to fit in range 0.0 to 1.0:
+    shimmer = jlimit(0.0f, 1.0f, shimmerAmount / 100.0f);
+}
+
+void DelayEffect::setShimmerPitch (float semitones)
+{
+    shimmerRatio = std::pow(2.0f, jlimit(-12.0f, 12.0f, semitones) / 12.0f);
+}
+
+void DelayEffect::setPingPong (float pingPongAmount)
+{
+    // pingPongAmount will be in range 0.0 to 100.0. Convert to fit in range 0.0 to 1.0:
+    const float newPingPong = jlimit(0.0f, 1.0f, pingPongAmount / 100.0f);
+    if (newPingPong == pingPong)
+        return;
+
+    pingPong = newPingPong;
+    updateFeedbackMatrix();
+}
+
+void DelayEffect::setWidth (float widthAmount)
+{
+    // widthAmount will be in range 0.0 to 100.0. Convert to fit in range 0.0 to 1.0:
+    width = jlimit(0.0f, 1.0f, widthAmount / 100.0f);
+}
+
+void DelayEffect::setRotation (float degrees)
+{
+    // Called every block: only rebuild the matrix when the angle actually moved
+    const float newRotation = degreesToRadians(jlimit(-90.0f, 90.0f, degrees));
+    if (newRotation == rotation)
+        return;
+
+    rotation = newRotation;
+    updateFeedbackMatrix();
+}
+
+void DelayEffect::updateFeedbackMatrix()
+{
+    const int numChannels = jmin(lineChannels, (int) maxChannels);
+    crossFeedback = numChannels > 1 && ! midSide && (pingPong > 0.0f || rotation != 0.0f);
+    
+    // Ping-pong blends the identity with a cyclic shift: channel c is fed by channel c + 1
+    std::array<float, maxChannels * maxChannels> shifted {};
+    for (int row = 0; row < numChannels; ++row)
+    {
+        shifted[row * maxChannels + row] += 1.0f - pingPong;
+        shifted[row * maxChannels + (row + 1) % numChannels] += pingPong;
+    }
+    
+    // Rotation then turns each pair of channels by the same angle on every repeat
+    const float c = std::cos(rotation);
+    const float s = std::sin(rotation);
+    feedbackMatrix = shifted;
+
+    for (int row = 0; row + 1 < numChannels; row += 2)
+    {
+        for (int col = 0; col < numChannels; ++col)
+        {
+            const float a = shifted[row * maxChannels + col];
+            const float b = shifted[(row + 1) * maxChannels + col];
+            feedbackMatrix[row * maxChannels + col]       = c * a - s * b;
+            feedbackMatrix[(row + 1) * maxChannels + col] = s * a + c * b;
+        }
+    }
+}
+
+void DelayEffect::setCompactStorage (bool shouldUseCompactStorage)
+{
+    // Allocates the new format and frees the old one, so this must never run while process() can:
+    // call it before prepare(), or off the audio thread with processing suspended
+    if (compactStorage == shouldUseCompactStorage)
+        return;
+
+    compactStorage = shouldUseCompactStorage;
+
+    if (lineLength == 0)
+        return;   // not prepared yet, prepare() allocates the chosen format
+
+    // Carry the current contents over to the new format, one channel-long run at a time
+    if (compactStorage)
+    {
+        compactBuffer.allocate((size_t) lineChannels * (size_t) lineLength, false);
+
+        for (int channel = 0; channel < lineChannels; ++channel)
+            packRun(delayBuffer.getReadPointer(channel), compactBuffer.get() + channel * lineLength, lineLength);
+
+        delayBuffer.setSize(0, 0);
+    }
+    else
+    {
+        delayBuffer.setSize(lineChannels, lineLength);
+
+        for (int channel = 0; channel < lineChannels; ++channel)
+            unpackRun(compactBuffer.get() + channel * lineLength, delayBuffer.getWritePointer(channel), lineLength);
+
+        compactBuffer.free();
+    }
+}
+
+void DelayEffect::setDuck (float duckAmount)
+{
+    // duckAmount will be in range 0.0 to 100.0. Convert to fit in range 0.0 to 1.0:
+    duck = jlimit(0.0f, 1.0f, duckAmount / 100.0f);
+}
+
+void DelayEffect::setDuckAttack (float attackMs)
+{
+    // One-pole coefficient reaching ~63% of a step in attackMs
+    duckAttackCoeff = 1.0f - std::exp(-1.0f / (jmax(0.1f, attackMs) * 0.001f * (float) sampleRate));
+}
+
+void DelayEffect::setDuckRelease (float releaseMs)
+{
+    duckReleaseCoeff = 1.0f - std::exp(-1.0f / (jmax(1.0f, releaseMs) * 0.001f * (float) sampleRate));
+}
+
+void DelayEffect::setDuckRms (bool shouldUseRms)
+{
+    // The envelope holds a level in one mode and a mean square in the other, so restart it
+    if (duckRms != shouldUseRms)
+        duckEnvelope = 0.0f;
+
+    duckRms = shouldUseRms;
+}
+
+void DelayEffect::setReverse (bool shouldReverse)
+{
+    // Picked up by process() with a retime crossfade, like a delay time change
+    reverseTarget = shouldReverse;
+}
+
+void DelayEffect::setTapeStop (bool shouldStop)
+{
+    tapeStop = shouldStop;
+}
+
+void DelayEffect::setTapeStopTime (float stopMs)
+{
+    // Speed change per sample, so a full stop (or restart) takes stopMs
+    tapeRamp = 1.0f / (jmax(1.0f, stopMs) * 0.001f * (float) sampleRate);
+}
+
+void DelayEffect::setFreeze (bool shouldFreeze)
+{
+    // Engaged / released at the start of the next process() call
+    freezeTarget = shouldFreeze;
+}
+
+template <typename SampleType>
+void DelayEffect::transcodeLine (SampleType* first, SampleType* second)
+{
+    // Same encoding as processLine(): mid = (l + r) / 2, side = (l - r) / 2, and back with l = m + s, r = m - s
+    const float scale = midSide ? 0.5f : 1.0f;
+
+    for (int i = 0; i < lineLength; ++i)
+    {
+        const float a = loadSample(first[i]);
+        const float b = loadSample(second[i]);
+        storeSample(first[i],  scale * (a + b));
+        storeSample(second[i], scale * (a - b));
+    }
+}
+
+template <typename SampleType>
+float DelayEffect::readInterpolated (const SampleType* delayData, float position) const
+{
+    // position must already be wrapped into [0, delayBufferSize)
+    const int delayBufferSize = lineLength;
+    const int i0   = (int) position;
+    const int i1   = (i0 + 1 < delayBufferSize) ? i0 + 1 : 0;
+    const float frac = position - (float) i0;
+
+    const float s0   = loadSample(delayData[i0]);
+    const float s1   = loadSample(delayData[i1]);
+
+    return s0 + frac * (s1 - s0);
+}
+
+int DelayEffect::getDuckKey (const AudioBuffer<float>& buffer, const AudioBuffer<float>* sidechain, int numChannels, int startSample, const float** keyData) const
+{
+    // Ducking key: the sidechain when the host feeds one, otherwise the dry input itself
+    const AudioBuffer<float>& key = (sidechain != nullptr && sidechain->getNumChannels() > 0) ? *sidechain : buffer;
+    const int numKeyChannels = (&key == &buffer) ? numChannels : jmin(key.getNumChannels(), (int) maxChannels);
+
+    for (int channel = 0; channel < numKeyChannels; ++channel)
+        keyData[channel] = key.getReadPointer(channel, startSample);
+
+    return numKeyChannels;
+}
+
+void DelayEffect::followDuck (const float* const* keyData, int numKeyChannels, int start, int numSamples)
+{
+    // Fills wetGains[0, numSamples) for the samples from start on, which must still hold the dry input.
+    // Only the envelope itself has to run sample by sample; the key and the gain curve run across the whole run
+    float* const gains = wetGains.data();
+
+    if (duck <= 0.0f)
+    {
+        std::fill(gains, gains + numSamples, wet);
+        return;
+    }
+
+    // Key: mean square or peak across channels
+    std::fill(gains, gains + numSamples, 0.0f);
+
+    for (int channel = 0; channel < numKeyChannels; ++channel)
+    {
+        const float* const key = keyData[channel] + start;
+
+        if (duckRms)
+            for (int i = 0; i < numSamples; ++i)
+                gains[i] += key[i] * key[i];
+        else
+            for (int i = 0; i < numSamples; ++i)
+                gains[i] = jmax(gains[i], std::abs(key[i]));
+    }
+
+    if (duckRms)
+        for (int i = 0; i < numSamples; ++i)
+            gains[i] /= (float) numKeyChannels;
+
+    // Envelope
+    float envelope = duckEnvelope;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const float coeff = gains[i] > envelope ? duckAttackCoeff : duckReleaseCoeff;
+        envelope += coeff * (gains[i] - envelope);
+        gains[i] = envelope;
+    }
+
+    duckEnvelope = envelope;
+
+    // Gain: full depth from the knee up
+    if (duckRms)
+        for (int i = 0; i < numSamples; ++i)
+            gains[i] = std::sqrt(gains[i]);
+
+    for (int i = 0; i < numSamples; ++i)
+        gains[i] = wet * (1.0f - duck * jmin(1.0f, gains[i] / duckKneeLevel));
+}
+
+void DelayEffect::clear()
+{
+    if (compactStorage)
+        compactBuffer.clear((size_t) lineChannels * (size_t) lineLength);
+    else
+        delayBuffer.clear();
+    writePosition = 0;
+    grainPhase    = 0.0f;
+    duckEnvelope  = 0.0f;
+    frozen        = false;
+    freezeBlend   = 0;
+    reversePosition = {};
+    previousReversePosition = {};
+    tapeSpeed     = 1.0f;
+    tapeLag       = 0.0f;
+}
+
+
+void DelayEffect::process (AudioBuffer<float>& buffer, const AudioBuffer<float>* sidechain)
+{
+    const int numChannels     = jmin(buffer.getNumChannels(), lineChannels, (int) maxChannels);
+    const int delayBufferSize = lineLength;
+    
+    // Freeze: loop the last delay time worth of audio before the write position. A fade only turns round
+    // once it is complete, so the line writes at most two fades past the loop end while the loop is in use;
+    // the loop and the seam crossfade behind it must stay clear of those writes
+    if (freezeTarget && ! frozen && freezeBlend == 0 && delayInSamples > 0)
+    {
+        frozen       = true;
+        freezeEnd    = writePosition;
+        freezeLength = jlimit(2, delayBufferSize - 1 - 3 * retimeLength, delayInSamples);
+        freezeFade   = jlimit(1, retimeLength, freezeLength / 2);
+        freezePhase  = 0;
+    }
+    else if (! freezeTarget && frozen && freezeBlend == retimeLength)
+    {
+        frozen = false;
+    }
+    
+    // Start a retime crossfade from the current read head to the new delay time
+    if (frozen)
+    {
+        // Delay time changes wait until the freeze is released
+    }
+    else if (delayInSamples == 0)
+    {
+        delayInSamples = previousDelayInSamples = targetDelayInSamples;
+        sideDelayInSamples = sidePreviousDelayInSamples = sideTargetDelayInSamples;
+        reverse = previousReverse = reverseTarget;
+    }
+    else if (retimePosition >= retimeLength
+             && (targetDelayInSamples != delayInSamples
+                  || (midSide && sideTargetDelayInSamples != sideDelayInSamples)
+                  || reverseTarget != reverse))
+    {
+        previousReverse = reverse;
+        reverse = reverseTarget;
+        previousReversePosition = reversePosition;
+        previousDelayInSamples = delayInSamples;
+        delayInSamples = targetDelayInSamples;
+        sidePreviousDelayInSamples = sideDelayInSamples;
+        sideDelayInSamples = sideTargetDelayInSamples;
+        retimePosition = 0;
+    }
+    
+    // The line runs until the loop has completely faded in, the frozen loop plays the rest of the block
+    const int numSamples  = buffer.getNumSamples();
+    const int lineSamples = frozen ? jmin(numSamples, retimeLength - freezeBlend) : numSamples;
+    
+    if (compactStorage)
+    {
+        int16* delayData[maxChannels];
+        for (int channel = 0; channel < numChannels; ++channel)
+            delayData[channel] = compactBuffer.get() + channel * delayBufferSize;
+
+        if (lineSamples > 0)
+            processLine(buffer, sidechain, delayData, 0, lineSamples);
+        if (lineSamples < numSamples)
+            processFrozen(buffer, sidechain, delayData, lineSamples, numSamples - lineSamples);
+    }
+    else
+    {
+        float* delayData[maxChannels];
+        for (int channel = 0; channel < numChannels; ++channel)
+            delayData[channel] = delayBuffer.getWritePointer(channel);
+
+        if (lineSamples > 0)
+            processLine(buffer, sidechain, delayData, 0, lineSamples);
+        if (lineSamples < numSamples)
+            processFrozen(buffer, sidechain, delayData, lineSamples, numSamples - lineSamples);
+    }
+    
+    // Once the crossfade is over there is only one read head left
+    if (retimePosition >= retimeLength)
+        previousReverse = reverse;
+}
+
+template <typename SampleType>
+void DelayEffect::readLoop (SampleType* const* delayData, int numChannels, int phase, float* loop) const
+{
+    const int delayBufferSize = lineLength;
+    const int fadeStart       = freezeLength - freezeFade;
+    
+    int readPos = freezeEnd - freezeLength + phase;
+    if (readPos < 0)
+        readPos += delayBufferSize;
+    else if (readPos >= delayBufferSize)
+        readPos -= delayBufferSize;
+    
+    float fadeOut = 1.0f;
+    float fadeIn  = 0.0f;
+    int seamPos   = readPos;
+
+    // Near the loop end, fade into the audio one loop length earlier, which runs into the loop start
+    if (phase >= fadeStart)
+    {
+        const int fadePos = (phase - fadeStart) * retimeLength / freezeFade;
+        fadeIn  = retimeTable[(size_t) fadePos];
+        fadeOut = retimeTable[(size_t) (retimeLength - 1 - fadePos)];
+
+        seamPos = readPos - freezeLength;
+        if (seamPos < 0)
+            seamPos += delayBufferSize;
+    }
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        loop[channel] = fadeOut * loadSample(delayData[channel][readPos])
+                      + fadeIn  * loadSample(delayData[channel][seamPos]);
+    
+    // A line recorded in mid/side mode holds mid & side, decode it like processLine() does
+    if (isSideChannel(1) && numChannels == 2)
+    {
+        const float mid  = loop[0];
+        const float side = loop[1] * width;
+        loop[0] = mid + side;
+        loop[1] = mid - side;
+    }
+}
+
+template <typename SampleType>
+void DelayEffect::processFrozen (AudioBuffer<float>& buffer, const AudioBuffer<float>* sidechain, SampleType* const* delayData, int startSample, int numSamples)
+{
+    const int numChannels = jmin(buffer.getNumChannels(), lineChannels, (int) maxChannels);
+    
+    // As in processLine(): the loop advances on a local copy, settings are read once per block
+    int localPhase       = freezePhase;
+    const float localDry = dry;
+    
+    float* outData[maxChannels];
+    for (int channel = 0; channel < numChannels; ++channel)
+        outData[channel] = buffer.getWritePointer(channel, startSample);
+    
+    // The loop keeps ducking under the key like the line does, one run of wet gains at a time
+    const float* keyData[maxChannels];
+    const int numKeyChannels = getDuckKey(buffer, sidechain, numChannels, startSample, keyData);
+    
+    // The loop is read in place: nothing is written and writePosition stays put
+    for (int i = 0; i < numSamples; ++i)
+    {
+        if (i % maxRunLength == 0)
+            followDuck(keyData, numKeyChannels, i, jmin((int) maxRunLength, numSamples - i));
+        
+        float loop[maxChannels];
+        readLoop(delayData, numChannels, localPhase, loop);
+
+        const float wetGain = wetGains[(size_t) (i % maxRunLength)];
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            outData[channel][i] = localDry * outData[channel][i] + wetGain * loop[channel];
+
+        if (++localPhase >= freezeLength)
+            localPhase = 0;
+    }
+    
+    freezePhase = localPhase;
+}
+
+template <typename SampleType>
+void DelayEffect::processLine (AudioBuffer<float>& buffer, const AudioBuffer<float>* sidechain, SampleType* const* delayData, int startSample, int numSamples)
+{
+    const int numChannels     = jmin(buffer.getNumChannels(), lineChannels, (int) maxChannels);
+    const int delayBufferSize = lineLength;
+    
+    // Grain delay sweeps by (1 - ratio) samples per sample to shift the pitch by ratio
+    const float grainIncrement = (1.0f - shimmerRatio) / grainSize;
+    const float maxReadDelay  = (float)(delayBufferSize - 2);
+    
+    // Running state is advanced on local copies and written back after the block
+    int localWritePos       = writePosition;
+    float localGrainPhase   = grainPhase;
+    int localRetimePos      = retimePosition;
+    auto localReversePos    = reversePosition;
+    auto localPrevReversePos = previousReversePosition;
+    float localTapeSpeed    = tapeSpeed;
+    float localTapeLag      = tapeLag;
+    int localFreezePhase    = freezePhase;
+    int localFreezeBlend    = freezeBlend;
+    
+    // Settings only change between blocks; local copies keep the loop from reloading them
+    // after every store through delayData / outData
+    const float localShimmer      = shimmer;
+    const float localWidth        = width;
+    const float localPingPong     = pingPong;
+    const float localDry          = dry;
+    const bool localReverse       = reverse;
+    const bool localPrevReverse   = previousReverse;
+    const bool localTapeStop      = tapeStop;
+    const float localTapeRamp     = tapeRamp;
+    const bool localCross         = crossFeedback;
+    const bool localFilters       = filtersPrepared;
+    const bool localFrozen        = frozen;
+    const int localRetimeLength   = retimeLength;
+    const auto matrix             = feedbackMatrix;
+    const float* const fades      = retimeTable.data();
+    const float* const window     = windowTable.data();
+    
+    float* outData[maxChannels];
+    for (int channel = 0; channel < numChannels; ++channel)
+        outData[channel] = buffer.getWritePointer(channel, startSample);
+    
+    // Per-channel delay lane: in mid/side mode channel 1 holds the side signal and has its own settings
+    const bool useMidSide = isSideChannel(1) && numChannels == 2;
+    int channelDelay[maxChannels];
+    int channelPrevDelay[maxChannels];
+    float channelFeedback[maxChannels];
+    size_t channelLane[maxChannels];
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        const bool side = isSideChannel(channel);
+        channelDelay[channel]     = side ? sideDelayInSamples : delayInSamples;
+        channelPrevDelay[channel] = side ? sidePreviousDelayInSamples : previousDelayInSamples;
+        channelFeedback[channel]  = side ? sideFeedback : feedback;
+        channelLane[channel]      = side ? 1 : 0;
+    }
+    
+    // Reverse segments are one delay time long, so a read never reaches back more than twice that.
+    // The outgoing heads of a retime stay on the segment length of the previous delay time
+    std::array<int, 2> reverseLength, previousReverseLength;
+    reverseLength[0] = jlimit(2, (delayBufferSize - 2) / 2, delayInSamples);
+    reverseLength[1] = jlimit(2, (delayBufferSize - 2) / 2, sideDelayInSamples);
+    previousReverseLength[0] = jlimit(2, (delayBufferSize - 2) / 2, previousDelayInSamples);
+    previousReverseLength[1] = jlimit(2, (delayBufferSize - 2) / 2, sidePreviousDelayInSamples);
+
+    for (size_t lane = 0; lane < 2; ++lane)
+    {
+        if (localReversePos[lane] >= reverseLength[lane])
+            localReversePos[lane] = 0;
+        if (localPrevReversePos[lane] >= previousReverseLength[lane])
+            localPrevReversePos[lane] = 0;
+    }
+    
+    // Two heads walk backwards from the write position, two samples of delay per sample
+    auto readReversed = [&] (const SampleType* channelData, int segment, int position)
+    {
+        float sample = 0.0f;
+
+        for (int head = 0; head < numGrainHeads; ++head)
+        {
+            int t = position + head * segment / numGrainHeads;
+            if (t >= segment)
+                t -= segment;
+
+            int readPos = localWritePos - (2 * t + 1);
+            if (readPos < 0)
+                readPos += delayBufferSize;
+
+            sample += window[(size_t) (t * windowTableSize / segment)] * loadSample(channelData[readPos]);
+        }
+
+        return sample;
+    };
+    
+    // Ducking key, followed a run at a time as each run begins
+    const float* keyData[maxChannels];
+    const int numKeyChannels = getDuckKey(buffer, sidechain, numChannels, startSample, keyData);
+    
+    // The line is written, and its forward tap read, in runs that stop short of the closest read head:
+    // nothing reads a sample of the run before the run is stored, so a 16-bit line is converted a
+    // whole run at a time instead of sample by sample
+    int runStart    = 0;
+    int runEnd      = 0;
+    int runWritePos = 0;
+    const float* tapRun[maxChannels];
+    float* storeRun[maxChannels];
+
+    auto untilSegmentEnd = [] (int segment, int position)
+    {
+        int length = segment;
+        for (int head = 0; head < numGrainHeads; ++head)
+        {
+            int t = position + head * segment / numGrainHeads;
+            if (t >= segment)
+                t -= segment;
+
+            length = jmin(length, segment - t);
+        }
+
+        return length;
+    };
+
+    auto beginRun = [&]
+    {
+        int length = jmin(numSamples - runEnd, (int) maxRunLength, delayBufferSize - localWritePos);
+        int tapPos[maxChannels];
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            length = jmin(length, channelDelay[channel]);
+            if (localRetimePos < localRetimeLength)
+                length = jmin(length, channelPrevDelay[channel]);
+
+            // A reverse head reads just behind the write position after it wraps to a new segment
+            const size_t lane = channelLane[channel];
+            if (localReverse)
+                length = jmin(length, untilSegmentEnd(reverseLength[lane], localReversePos[lane]));
+            if (localPrevReverse && localRetimePos < localRetimeLength)
+                length = jmin(length, untilSegmentEnd(previousReverseLength[lane], localPrevReversePos[lane]));
+
+            tapPos[channel] = localWritePos - channelDelay[channel];
+            if (tapPos[channel] < 0)
+                tapPos[channel] += delayBufferSize;
+
+            length = jmin(length, delayBufferSize - tapPos[channel]);
+        }
+
+        runStart    = runEnd;
+        runEnd      = runStart + length;
+        runWritePos = localWritePos;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            tapRun[channel]   = localReverse ? nullptr
+                                             : readRun(delayData[channel] + tapPos[channel], tapScratch.data() + channel * maxRunLength, length);
+            storeRun[channel] = writeRun(delayData[channel] + runWritePos, storeScratch.data() + channel * maxRunLength);
+        }
+
+        followDuck(keyData, numKeyChannels, runStart, length);
+    };
+
+    auto endRun = [&]
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+            commitRun(delayData[channel] + runWritePos, storeRun[channel], runEnd - runStart);
+    };
+    
+    float lineIn[maxChannels];
+    float dlyWet[maxChannels];
+    float fb[maxChannels];
+    float grainOffset[numGrainHeads];
+    float grainWindow[numGrainHeads];
+
+    // Handle delay sample by sample, all channels together so the feedback can cross between them
+    for (int i = 0; i < numSamples; ++i)
+    {
+        if (i == runEnd)
+        {
+            if (i > 0)
+                endRun();
+            beginRun();
+        }
+        
+        const bool retiming = localRetimePos < localRetimeLength;
+        
+        // Tape stop: ramp the read speed down and let the read head fall behind;
+        // on release the head jumps back and fades in as the speed ramps up again
+        if (localTapeStop)
+        {
+            localTapeSpeed = jmax(0.0f, localTapeSpeed - localTapeRamp);
+            localTapeLag   = jmin(maxReadDelay, localTapeLag + 1.0f - localTapeSpeed);
+        }
+        else if (localTapeSpeed < 1.0f)
+        {
+            localTapeSpeed = jmin(1.0f, localTapeSpeed + localTapeRamp);
+            localTapeLag   = 0.0f;
+        }
+        
+        // Shimmer: grain offsets behind the delay tap and window gains are shared by all channels
+        if (localShimmer > 0.0f)
+        {
+            for (int head = 0; head < numGrainHeads; ++head)
+            {
+                float phase = localGrainPhase + (float) head / (float) numGrainHeads;
+                phase -= std::floor(phase);
+
+                grainOffset[head] = phase * grainSize;
+                grainWindow[head] = window[jmin(windowTableSize - 1, (int)(phase * (float) windowTableSize))];
+            }
+
+            localGrainPhase += grainIncrement;
+            localGrainPhase -= std::floor(localGrainPhase);
+        }
+        
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            float dly = 0.0f;
+
+            if (localReverse)
+            {
+                dly = readReversed(delayData[channel], reverseLength[channelLane[channel]], localReversePos[channelLane[channel]]);
+            }
+            else if (localTapeLag > 0.0f)
+            {
+                float readPos = (float) localWritePos - jmin(maxReadDelay, (float) channelDelay[channel] + localTapeLag);
+                if (readPos < 0.0f)
+                    readPos += (float) delayBufferSize;
+
+                dly = readInterpolated(delayData[channel], readPos);
+            }
+            else
+            {
+                dly = tapRun[channel][i - runStart];
+            }
+            
+            // Only while a retime of this channel's lane is in progress: blend in the outgoing read heads,
+            // which play in the other direction when reverse has just been toggled
+            const bool fadeOut = retiming && (localPrevReverse != localReverse
+                                               || channelPrevDelay[channel] != channelDelay[channel]);
+            float outgoing = 0.0f;
+
+            if (fadeOut)
+            {
+                if (localPrevReverse)
+                {
+                    outgoing = readReversed(delayData[channel], previousReverseLength[channelLane[channel]], localPrevReversePos[channelLane[channel]]);
+                }
+                else
+                {
+                    int prevReadPos = localWritePos - channelPrevDelay[channel];
+                    if (prevReadPos < 0)
+                        prevReadPos += delayBufferSize;
+
+                    outgoing = loadSample(delayData[channel][prevReadPos]);
+                }
+
+                dly = fades[localRetimePos] * dly + fades[localRetimeLength - 1 - localRetimePos] * outgoing;
+            }
+            
+            // A stopping tape also loses level, so a halted head neither sounds nor feeds back
+            dly *= localTapeSpeed;
+            
+            float wetSample = dly;
+            
+            if (localFilters)
+            {
+                wetSample = hpFilters[channel].processSample(wetSample);
+                wetSample = lpFilters[channel].processSample(wetSample);
+            }
+            
+            dlyWet[channel] = wetSample;
+            
+            float fbSource = wetSample;
+            
+            // Shimmer: replace part of the feedback with the pitch-shifted grains
+            if (localShimmer > 0.0f)
+            {
+                float shifted = 0.0f;
+                for (int head = 0; head < numGrainHeads; ++head)
+                {
+                    float grainPos = (float) localWritePos - jmin(maxReadDelay, (float) channelDelay[channel] + localTapeLag + grainOffset[head]);
+                    if (grainPos < 0.0f)
+                        grainPos += (float) delayBufferSize;
+
+                    shifted += grainWindow[head] * readInterpolated(delayData[channel], grainPos);
+                }
+
+                // The grains ride on the same tape as the main head, so they stop with it too
+                shifted *= localTapeSpeed;
+
+                fbSource += localShimmer * (shifted - fbSource);
+            }
+            
+            float fbSample = fbSource * channelFeedback[channel];
+            
+            // Process the feedback through HP and LP (per channel)
+            if (localFilters)
+            {
+                fbSample = hpFilters[channel].processSample(fbSample);
+                fbSample = lpFilters[channel].processSample(fbSample);
+            }
+            
+            fb[channel]     = fbSample;
+            lineIn[channel] = outData[channel][i];   // host-provided input
+        }
+        
+        if (retiming)
+            ++localRetimePos;
+        
+        // The outgoing reverse heads keep walking while they fade out
+        if (localReverse)
+            for (size_t lane = 0; lane < 2; ++lane)
+                if (++localReversePos[lane] >= reverseLength[lane])
+                    localReversePos[lane] = 0;
+
+        if (retiming && localPrevReverse)
+            for (size_t lane = 0; lane < 2; ++lane)
+                if (++localPrevReversePos[lane] >= previousReverseLength[lane])
+                    localPrevReversePos[lane] = 0;
+        
+        // Mid/side: encode the input on its way into the line
+        if (useMidSide)
+        {
+            const float mid  = 0.5f * (lineIn[0] + lineIn[1]);
+            const float side = 0.5f * (lineIn[0] - lineIn[1]);
+            lineIn[0] = mid;
+            lineIn[1] = side;
+        }
+        
+        // Cross-feedback: mix the feedback of every channel into every channel
+        if (localCross)
+        {
+            float mixed[maxChannels];
+            for (int row = 0; row < numChannels; ++row)
+            {
+                mixed[row] = 0.0f;
+                for (int col = 0; col < numChannels; ++col)
+                    mixed[row] += matrix[row * maxChannels + col] * fb[col];
+            }
+            
+            // Ping-pong: the input is fed into the first channel only, the matrix bounces it around
+            float othersIn = 0.0f;
+            for (int channel = 1; channel < numChannels; ++channel)
+            {
+                othersIn += lineIn[channel];
+                lineIn[channel] *= 1.0f - localPingPong;
+            }
+            lineIn[0] += localPingPong * othersIn;
+            
+            for (int channel = 0; channel < numChannels; ++channel)
+                fb[channel] = mixed[channel];
+        }
+        
+        // Mid/side: decode the wet signal, with the width scaling the side
+        if (useMidSide)
+        {
+            const float mid  = dlyWet[0];
+            const float side = dlyWet[1] * localWidth;
+            dlyWet[0] = mid + side;
+            dlyWet[1] = mid - side;
+        }
+        // Stereo width of the wet signal, per pair of channels
+        else if (localWidth < 1.0f)
+        {
+            for (int channel = 0; channel + 1 < numChannels; channel += 2)
+            {
+                const float mid  = 0.5f * (dlyWet[channel] + dlyWet[channel + 1]);
+                const float side = 0.5f * (dlyWet[channel] - dlyWet[channel + 1]) * localWidth;
+                dlyWet[channel]     = mid + side;
+                dlyWet[channel + 1] = mid - side;
+            }
+        }
+
+        // Freeze fading in or out: blend the loop, as processFrozen() plays it, with what the line plays
+        if (localFrozen || localFreezeBlend > 0)
+        {
+            float loop[maxChannels];
+            readLoop(delayData, numChannels, localFreezePhase, loop);
+
+            const float loopGain = localFreezeBlend > 0 ? fades[localFreezeBlend - 1] : 0.0f;
+            const float lineGain = localFreezeBlend < localRetimeLength ? fades[localRetimeLength - 1 - localFreezeBlend] : 0.0f;
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                dlyWet[channel] = lineGain * dlyWet[channel] + loopGain * loop[channel];
+
+            if (++localFreezePhase >= freezeLength)
+                localFreezePhase = 0;
+
+            localFreezeBlend += localFrozen ? 1 : -1;
+        }
+
+        const float wetGain = wetGains[(size_t) (i - runStart)];
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            const float in = outData[channel][i];
+            outData[channel][i] = localDry * in + wetGain * dlyWet[channel];
+
+            // Write back: input + filtered feedback
+            storeRun[channel][i - runStart] = lineIn[channel] + fb[channel];
+        }
+
+        if (++localWritePos >= delayBufferSize)
+            localWritePos = 0;
+    }
+    
+    if (numSamples > 0)
+        endRun();
+    
+    writePosition   = localWritePos;
+    grainPhase      = localGrainPhase;
+    retimePosition  = localRetimePos;
+    reversePosition = localReversePos;
+    previousReversePosition = localPrevReversePos;
+    tapeSpeed       = localTapeSpeed;
+    tapeLag         = localTapeLag;
+    freezePhase     = localFreezePhase;
+    freezeBlend     = localFreezeBlend;
+}
+
+
+void CircularBufferAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
+{
+    ignoreUnused(samplesPerBlock);
+
+    // Processing is stopped here, so the line can be allocated in the chosen format straight away
+    delay.setCompactStorage(*treeState.getRawParameterValue(PARAM_STORAGE_ID) >= 0.5f);
+    delay.prepare(sampleRate, getTotalNumOutputChannels(), maxDelaySeconds);
+
+    readAPVTS();
+}
+
+void CircularBufferAudioProcessor::releaseResources()
+{
+    delay.clear();
+}
+
+#ifndef JucePlugin_PreferredChannelConfigurations
+bool CircularBufferAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
+{
+  #if JucePlugin_IsMidiEffect
+    ignoreUnused (layouts);
+    return true;
+  #else
+    // This is the place where you check if the layout is supported.
+    // In this template code we only support mono or stereo.
+    // Some plugin hosts, such as certain GarageBand versions, will only
+    // load plugins that support stereo bus layouts.
+    if (layouts.getMainOutputChannelSet() != AudioChannelSet::mono()
+     && layouts.getMainOutputChannelSet() != AudioChannelSet::stereo())
+        return false;
+
+    // This checks if the input layout matches the output layout
+   #if ! JucePlugin_IsSynth
+    if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
+        return false;
+
+    // The optional ducking sidechain can be off, mono or stereo
+    const auto sidechainSet = layouts.getChannelSet(true, 1);
+    if (! sidechainSet.isDisabled()
+     && sidechainSet != AudioChannelSet::mono()
+     && sidechainSet != AudioChannelSet::stereo())
+        return false;
+   #endif
+
+    return true;
+  #endif
+}
+#endif
+
+void CircularBufferAudioProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer& midiMessages)
+{
+    ScopedNoDenormals noDenormals;
+    
+    auto totalNumInputChannels  = getTotalNumInputChannels();
+    auto totalNumOutputChannels = getTotalNumOutputChannels();
+
+    for (int ch = totalNumInputChannels; ch < totalNumOutputChannels; ++ch)
+        buffer.clear (ch, 0, buffer.getNumSamples());
+
+    // Pick up the host tempo for the synced delay time (keep the last one if the host has none)
+    if (auto* playHead = getPlayHead())
+        if (auto position = playHead->getPosition())
+            if (auto bpm = position->getBpm())
+                hostBpm = *bpm;
+
+    readAPVTS();
+    
+    // The delay runs on the main bus; the sidechain bus (when enabled) only keys the ducking
+    auto mainBuffer = getBusBuffer(buffer, false, 0);
+
+    if (getBusCount(true) > 1 && getChannelCountOfBus(true, 1) > 0)
+    {
+        const auto sidechainBuffer = getBusBuffer(buffer, true, 1);
+        delay.process (mainBuffer, &sidechainBuffer);
+    }
+    else
+    {
+        delay.process (mainBuffer);
+    }
+}
+
+void CircularBufferAudioProcessor::readAPVTS()
+{
+    // 1) Read delay time (ms) and set it
+    float delayMs = *treeState.getRawParameterValue(PARAM_DELAY_TIME_ID);
+    
+    if (*treeState.getRawParameterValue(PARAM_SYNC_ID) >= 0.5f && hostBpm > 0.0)
+    {
+        // Note divisions as fractions of a whole note, and their straight / dotted / triplet scaling
+        static const float divisions[] = { 1.0f, 0.5f, 0.25f, 0.125f, 0.0625f, 0.03125f };
+        static const float modes[]     = { 1.0f, 1.5f, 2.0f / 3.0f };
+
+        int divisionIndex       = jlimit(0, 5, (int) *treeState.getRawParameterValue(PARAM_SYNC_DIVISION_ID));
+        const int modeIndex     = jlimit(0, 2, (int) *treeState.getRawParameterValue(PARAM_SYNC_MODE_ID));
+        const float wholeNoteMs = (float)(240000.0 / hostBpm);
+
+        // Long divisions at slow tempos don't fit in the line (1/1 needs 2 s at 120 BPM, 1/1 dotted
+        // at 60 BPM needs 6 s): step down to the next shorter division rather than clamp off the grid
+        while (divisionIndex < 5 && wholeNoteMs * divisions[divisionIndex] * modes[modeIndex] > maxDelaySeconds * 1000.0f)
+            ++divisionIndex;
+
+        delayMs = wholeNoteMs * divisions[divisionIndex] * modes[modeIndex];
+    }
+    
+    delay.setDelayTime(delayMs);
+    
+    // 2) Read decay time (ms)
+    const float decayMs = *treeState.getRawParameterValue(PARAM_DECAY_TIME_MS_ID);
+
+    // Protect against edge cases
+    const float T = delay.getDelayTime();
+    const float D = std::max(0.001f, decayMs * 0.001f);
+
+    // Compute linear feedback f so that the tail reaches -60 dB in D seconds:
+    // Using: f = 0.001^(T / D) = 10^(-3 * T / D)
+    float f = std::pow(0.001f, T / D);
+
+    // Match previous limits
+    f = jlimit(0.0f, 0.995f, f);
+
+    delay.setFeedback(f);
+
+    // Wet & Dry parameters:
+    delay.setWet(*treeState.getRawParameterValue(PARAM_WET_ID));
+    delay.setDry(*treeState.getRawParameterValue(PARAM_DRY_ID));
+    
+    // Mid/side parameters (switched first, so the filters below land on the right channels):
+    delay.setMidSide(*treeState.getRawParameterValue(PARAM_MID_SIDE_ID) >= 0.5f);
+    delay.setSideDelayTime(*treeState.getRawParameterValue(PARAM_SIDE_DELAY_TIME_ID));
+
+    const float sideT = delay.getSideDelayTime();
+    const float sideD = std::max(0.001f, *treeState.getRawParameterValue(PARAM_SIDE_DECAY_TIME_MS_ID) * 0.001f);
+    delay.setSideFeedback(jlimit(0.0f, 0.995f, std::pow(0.001f, sideT / sideD)));
+
+    delay.setSideHighPassCutoff(*treeState.getRawParameterValue(PARAM_SIDE_HP_CUTOFF_ID));
+    delay.setSideLowPassCutoff(*treeState.getRawParameterValue(PARAM_SIDE_LP_CUTOFF_ID));
+    
+    // Hi & Low pass parameters:
+    delay.setHighPassCutoff(*treeState.getRawParameterValue(PARAM_HP_CUTOFF_ID));
+    delay.setLowPassCutoff(*treeState.getRawParameterValue(PARAM_LP_CUTOFF_ID));
+    
+    // Shimmer parameters (choice index maps onto the interval table):
+    static const float shimmerSemitones[] = { -12.0f, -7.0f, 7.0f, 12.0f };
+    const int pitchIndex = jlimit(0, 3, (int) *treeState.getRawParameterValue(PARAM_SHIMMER_PITCH_ID));
+
+    delay.setShimmer(*treeState.getRawParameterValue(PARAM_SHIMMER_ID));
+    delay.setShimmerPitch(shimmerSemitones[pitchIndex]);
+    
+    // Ping-pong, width & rotation parameters:
+    delay.setPingPong(*treeState.getRawParameterValue(PARAM_PING_PONG_ID));
+    delay.setWidth(*treeState.getRawParameterValue(PARAM_WIDTH_ID));
+    delay.setRotation(*treeState.getRawParameterValue(PARAM_ROTATION_ID));
+    
+    // Ducking parameters:
+    delay.setDuck(*treeState.getRawParameterValue(PARAM_DUCK_ID));
+    delay.setDuckAttack(*treeState.getRawParameterValue(PARAM_DUCK_ATTACK_ID));
+    delay.setDuckRelease(*treeState.getRawParameterValue(PARAM_DUCK_RELEASE_ID));
+    delay.setDuckRms(*treeState.getRawParameterValue(PARAM_DUCK_MODE_ID) >= 0.5f);
+    
+    // Reverse & tape stop:
+    delay.setReverse(*treeState.getRawParameterValue(PARAM_REVERSE_ID) >= 0.5f);
+    delay.setTapeStop(*treeState.getRawParameterValue(PARAM_TAPE_STOP_ID) >= 0.5f);
+    delay.setTapeStopTime(*treeState.getRawParameterValue(PARAM_TAPE_STOP_TIME_ID));
+    
+    // Freeze:
+    const bool frozen = *treeState.getRawParameterValue(PARAM_FREEZE_ID) >= 0.5f;
+    delay.setFreeze(frozen);
+    
+    // Tail: the first repeat arrives after T, then takes k more round trips to reach -60 dB
+    auto tailFor = [] (float T, float f)
+    {
+        if (T <= 0.0f) return 0.0;
+        return T * (1.0 + (f > 0.0f ? std::log(0.001) / std::log(std::max(0.0001f, f)) : 0.0));
+    };
+
+    double tail = tailFor(delay.getDelayTime(), delay.getFeedback());
+
+    if (*treeState.getRawParameterValue(PARAM_MID_SIDE_ID) >= 0.5f)
+        tail = std::max(tail, tailFor(delay.getSideDelayTime(), delay.getSideFeedback()));
+
+    if (frozen)
+        tail = std::numeric_limits<double>::infinity();
+
+    tailLengthSeconds = tail;
+}
+
+void CircularBufferAudioProcessor::parameterChanged (const String& parameterID, float newValue)
+{
+    // May be called on the audio thread (automation), which must not allocate
+    ignoreUnused(parameterID, newValue);
+    triggerAsyncUpdate();
+}
+
+void CircularBufferAudioProcessor::handleAsyncUpdate()
+{
+    // Holding the callback lock keeps processBlock() out while the line changes format
+    const ScopedLock sl (getCallbackLock());
+    delay.setCompactStorage(*treeState.getRawParameterValue(PARAM_STORAGE_ID) >= 0.5f);
+}
+
+//==============================================================================
+bool CircularBufferAudioProcessor::hasEditor() const
+{
+    return true; // (change this to false if you choose to not supply an editor)
+}
+
+AudioProcessorEditor* CircularBufferAudioProcessor::createEditor()
+{
+    return new CircularBufferAudioProcessorEditor (*this);
+}
+
+//==============================================================================
+void CircularBufferAudioProcessor::getStateInformation (MemoryBlock& destData)
+{
+    auto state = treeState.copyState();
+    std::unique_ptr<XmlElement> xml(state.createXml());
+    copyXmlToBinary(*xml, destData);
+}
+
+void CircularBufferAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
+{
+    std::unique_ptr<XmlElement> theParams(getXmlFromBinary(data, sizeInBytes));
+    if (theParams != nullptr)
+    {
+        // If xml has name "saveParams"
+        if(theParams -> hasTagName(treeState.state.getType()))
+        {
+            treeState.replaceState(ValueTree::fromXml(*theParams));
+        }
+    }
+}
+
+//==============================================================================
+// This creates new instances of the plugin..
+AudioProcessor* JUCE_CALLTYPE createPluginFilter()
+{
+    return new CircularBufferAudioProcessor();
+}
@@ -1,110 +1,264 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin processor.
-
-  ==============================================================================
-*/
-
-#pragma once
-
-#include <JuceHeader.h>
-#define PARAM_DELAY_TIME_ID "delayTime"
-#define PARAM_DECAY_TIME_MS_ID "decayTimeMs"
-#define PARAM_WET_ID "wet"
-#define PARAM_DRY_ID "dry"
-#define PARAM_HP_CUTOFF_ID "hipass"
-#define PARAM_LP_CUTOFF_ID "lowpass"
-
-using namespace juce;
-
-//==============================================================================
-/**
-*/
-
-class DelayEffect
-{
-public:
-    void prepare (double sr, int channels, float maxDelayTime);
-    
-    void setDelayTime (float delayTime);
-    void setFeedback (float feedbackAmount);
-    void setWet (float wetAmount);
-    void setDry (float dryAmount);
-    void setHighPassCutoff(float hpHz);
-    void setLowPassCutoff(float lpHz);
-    
-    void clear();
-    void process (AudioBuffer<float>& buffer);
-    
-    float getDelayTime() const { return delayInSamples / static_cast<float>(sampleRate); }
-    float getFeedback()  const { return feedback; }
-
-private:
-    AudioBuffer<float> delayBuffer;
-    int writePosition   = 0;
-    double sampleRate   = 44100.0;
-    int delayInSamples  = 0;
-    
-    float feedback  = 0.5f;
-    float wet       = 50.0;
-    float dry       = 100.0;
-    
-    std::vector<dsp::IIR::Filter<float>> hpFilters;
-    std::vector<dsp::IIR::Filter<float>> lpFilters;
-    float hpCutoff = 60.0f;
-    float lpCutoff = 8000.0f;
-    bool filtersPrepared = false;
-};
-
-class CircularBufferAudioProcessor  : public AudioProcessor
-{
-public:
-    //==============================================================================
-    CircularBufferAudioProcessor();
-    ~CircularBufferAudioProcessor() override;
-    
-    AudioProcessorValueTreeState treeState;
-    DelayEffect& getDelay() noexcept { return delay; }
-
-    //==============================================================================
-    void prepareToPlay (double sampleRate, int samplesPerBlock) override;
-    void releaseResources() override;
-
-   #ifndef JucePlugin_PreferredChannelConfigurations
-    bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
-   #endif
-
-    void processBlock (AudioBuffer<float>&, MidiBuffer&) override;
-    void readAPVTS();
-
-    //==============================================================================
-    AudioProcessorEditor* createEditor() override;
-    bool hasEditor() const override;
-
-    //==============================================================================
-    const String getName() const override;
-
-    bool acceptsMidi() const override;
-    bool producesMidi() const override;
-    bool isMidiEffect() const override;
-    double getTailLengthSeconds() const override;
-
-    //==============================================================================
-    int getNumPrograms() override;
-    int getCurrentProgram() override;
-    void setCurrentProgram (int index) override;
-    const String getProgramName (int index) override;
-    void changeProgramName (int index, const String& newName) override;
-
-    //==============================================================================
-    void getStateInformation (MemoryBlock& destData) override;
-    void setStateInformation (const void* data, int sizeInBytes) override;
-
-private:
-    DelayEffect delay;
-    
-    static AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
-    //==============================================================================
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CircularBufferAudioProcessor)
-};
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin processor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#define PARAM_DELAY_TIME_ID "delayTime"
+#define PARAM_DECAY_TIME_MS_ID "decayTimeMs"
+#define PARAM_WET_ID "wet"
+#define PARAM_DRY_ID "dry"
+#define PARAM_HP_CUTOFF_ID "hipass"
+#define PARAM_LP_CUTOFF_ID "lowpass"
+#define PARAM_SHIMMER_ID "shimmer"
+#define PARAM_SHIMMER_PITCH_ID "shimmerPitch"
+#define PARAM_SYNC_ID "sync"
+#define PARAM_SYNC_DIVISION_ID "syncDivision"
+#define PARAM_SYNC_MODE_ID "syncMode"
+#define PARAM_PING_PONG_ID "pingPong"
+#define PARAM_WIDTH_ID "width"
+#define PARAM_ROTATION_ID "rotation"
+#define PARAM_STORAGE_ID "storage"
+#define PARAM_DUCK_ID "duck"
+#define PARAM_DUCK_ATTACK_ID "duckAttack"
+#define PARAM_DUCK_RELEASE_ID "duckRelease"
+#define PARAM_DUCK_MODE_ID "duckMode"
+#define PARAM_FREEZE_ID "freeze"
+#define PARAM_MID_SIDE_ID "midSide"
+#define PARAM_SIDE_DELAY_TIME_ID "sideDelayTime"
+#define PARAM_SIDE_DECAY_TIME_MS_ID "sideDecayTimeMs"
+#define PARAM_SIDE_HP_CUTOFF_ID "sideHipass"
+#define PARAM_SIDE_LP_CUTOFF_ID "sideLowpass"
+#define PARAM_REVERSE_ID "reverse"
+#define PARAM_TAPE_STOP_ID "tapeStop"
+#define PARAM_TAPE_STOP_TIME_ID "tapeStopTime"
+
+using namespace juce;
+
+//==============================================================================
+/**
+*/
+
+class DelayEffect
+{
+public:
+    void prepare (double sr, int channels, float maxDelayTime);
+    
+    void setDelayTime (float delayTime);
+    void setFeedback (float feedbackAmount);
+    void setWet (float wetAmount);
+    void setDry (float dryAmount);
+    void setHighPassCutoff(float hpHz);
+    void setLowPassCutoff(float lpHz);
+    void setShimmer (float shimmerAmount);
+    void setShimmerPitch (float semitones);
+    void setPingPong (float pingPongAmount);
+    void setWidth (float widthAmount);
+    void setRotation (float degrees);
+    void setCompactStorage (bool shouldUseCompactStorage);
+    void setDuck (float duckAmount);
+    void setDuckAttack (float attackMs);
+    void setDuckRelease (float releaseMs);
+    void setDuckRms (bool shouldUseRms);
+    void setFreeze (bool shouldFreeze);
+    void setMidSide (bool shouldUseMidSide);
+    void setSideDelayTime (float delayTime);
+    void setSideFeedback (float feedbackAmount);
+    void setSideHighPassCutoff (float hpHz);
+    void setSideLowPassCutoff (float lpHz);
+    void setReverse (bool shouldReverse);
+    void setTapeStop (bool shouldStop);
+    void setTapeStopTime (float stopMs);
+    
+    void clear();
+    void process (AudioBuffer<float>& buffer, const AudioBuffer<float>* sidechain = nullptr);
+    
+    float getDelayTime() const { return targetDelayInSamples / static_cast<float>(sampleRate); }
+    float getFeedback()  const { return feedback; }
+    float getSideDelayTime() const { return sideTargetDelayInSamples / static_cast<float>(sampleRate); }
+    float getSideFeedback()  const { return sideFeedback; }
+
+private:
+    template <typename SampleType>
+    void processLine (AudioBuffer<float>& buffer, const AudioBuffer<float>* sidechain, SampleType* const* delayData, int startSample, int numSamples);
+    template <typename SampleType>
+    void processFrozen (AudioBuffer<float>& buffer, const AudioBuffer<float>* sidechain, SampleType* const* delayData, int startSample, int numSamples);
+    template <typename SampleType>
+    void readLoop (SampleType* const* delayData, int numChannels, int phase, float* loop) const;
+    template <typename SampleType>
+    void transcodeLine (SampleType* first, SampleType* second);
+    template <typename SampleType>
+    float readInterpolated (const SampleType* delayData, float position) const;
+    int getDuckKey (const AudioBuffer<float>& buffer, const AudioBuffer<float>* sidechain, int numChannels, int startSample, const float** keyData) const;
+    void followDuck (const float* const* keyData, int numKeyChannels, int start, int numSamples);
+    void updateFeedbackMatrix();
+    bool isSideChannel (int channel) const { return midSide && channel == 1 && lineChannels == 2; }
+    
+    static constexpr int maxChannels = 8;
+
+    // The line lives in exactly one of delayBuffer (float) or compactBuffer (16-bit fixed point
+    // with 12 dB of headroom, half the memory), lineChannels x lineLength samples either way
+    AudioBuffer<float> delayBuffer;
+    HeapBlock<int16> compactBuffer;
+    
+    // processLine() reads and writes the line in runs of up to maxRunLength samples;
+    // a 16-bit line is unpacked into / packed from these, a float line is used in place
+    static constexpr int maxRunLength = 256;
+    std::array<float, maxChannels * maxRunLength> tapScratch {};
+    std::array<float, maxChannels * maxRunLength> storeScratch {};
+    bool compactStorage = false;
+    int lineChannels    = 0;
+    int lineLength      = 0;
+    int writePosition   = 0;
+    double sampleRate   = 44100.0;
+    int delayInSamples  = 0;
+    
+    // Retiming: when the delay time changes, the old read head fades out while
+    // the new one fades in, following a precomputed equal-power curve
+    int targetDelayInSamples   = 0;
+    int previousDelayInSamples = 0;
+    int retimePosition = 0;
+    int retimeLength   = 0;
+    std::vector<float> retimeTable;
+    
+    float feedback  = 0.5f;
+    float wet       = 50.0;
+    float dry       = 100.0;
+    
+    std::vector<dsp::IIR::Filter<float>> hpFilters;
+    std::vector<dsp::IIR::Filter<float>> lpFilters;
+    float hpCutoff = 60.0f;
+    float lpCutoff = 8000.0f;
+    bool filtersPrepared = false;
+    
+    // Shimmer: two granular read heads, half a grain apart, sweep across the
+    // buffer behind the delay tap and are crossfaded by a precomputed Hann window
+    static constexpr int numGrainHeads   = 2;
+    static constexpr int windowTableSize = 1024;
+    std::vector<float> windowTable;
+    float shimmer       = 0.0f;
+    float shimmerRatio  = 2.0f;
+    float grainPhase    = 0.0f;
+    float grainSize     = 2205.0f;
+    
+    // Cross-feedback: feedbackMatrix[row * maxChannels + col] is the gain from channel col into row
+    std::array<float, maxChannels * maxChannels> feedbackMatrix {};
+    float pingPong      = 0.0f;
+    float width         = 1.0f;
+    float rotation      = 0.0f;
+    bool crossFeedback  = false;
+    
+    // Ducking: a peak or RMS follower on the dry input (or the sidechain) pulls the wet level down;
+    // in RMS mode the envelope follows the mean square and is square-rooted before the knee
+    static constexpr float duckKneeLevel = 0.25f;   // full depth from -12 dBFS up
+    float duck              = 0.0f;
+    bool duckRms            = false;
+    float duckAttackCoeff   = 1.0f;
+    float duckReleaseCoeff  = 1.0f;
+    float duckEnvelope      = 0.0f;
+    std::array<float, maxRunLength> wetGains {};    // followDuck(): the wet gain for each sample of a run
+    
+    // Freeze: writes stop and the freezeLength samples before freezeEnd are looped in place,
+    // crossfading the loop end into the audio that led up to its start. The loop fades in and out
+    // over whatever the line was playing (freezeBlend counts from 0 to retimeLength through the fade),
+    // with processLine() running underneath for as long as the line is still audible
+    bool frozen         = false;
+    bool freezeTarget   = false;
+    int freezeEnd       = 0;
+    int freezeLength    = 0;
+    int freezePhase     = 0;
+    int freezeFade      = 0;
+    int freezeBlend     = 0;
+    
+    // Mid/side: channels 0 & 1 of the line hold mid & side, the side lane has its own settings
+    bool midSide        = false;
+    int sideDelayInSamples          = 0;
+    int sideTargetDelayInSamples    = 0;
+    int sidePreviousDelayInSamples  = 0;
+    float sideFeedback  = 0.5f;
+    float sideHpCutoff  = 60.0f;
+    float sideLpCutoff  = 8000.0f;
+    
+    // Reverse: each lane (main / side) plays its last delay time backwards, as two
+    // windowed segments half a segment apart; reversePosition counts through a segment.
+    // Toggling, or retiming while reversed, crossfades from the previousReverse heads, which
+    // carry on through their own segment length from previousReversePosition
+    bool reverse        = false;
+    bool reverseTarget  = false;
+    bool previousReverse = false;
+    std::array<int, 2> reversePosition {};
+    std::array<int, 2> previousReversePosition {};
+    
+    // Tape stop: the read head slows down to a halt, falling further behind the write head
+    bool tapeStop       = false;
+    float tapeRamp      = 0.0f;
+    float tapeSpeed     = 1.0f;
+    float tapeLag       = 0.0f;
+
+};
+
+class CircularBufferAudioProcessor  : public AudioProcessor,
+                                      private AudioProcessorValueTreeState::Listener,
+                                      private AsyncUpdater
+{
+public:
+    //==============================================================================
+    CircularBufferAudioProcessor();
+    ~CircularBufferAudioProcessor() override;
+    
+    AudioProcessorValueTreeState treeState;
+    DelayEffect& getDelay() noexcept { return delay; }
+
+    //==============================================================================
+    void prepareToPlay (double sampleRate, int samplesPerBlock) override;
+    void releaseResources() override;
+
+   #ifndef JucePlugin_PreferredChannelConfigurations
+    bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
+   #endif
+
+    void processBlock (AudioBuffer<float>&, MidiBuffer&) override;
+    void readAPVTS();
+
+    //==============================================================================
+    AudioProcessorEditor* createEditor() override;
+    bool hasEditor() const override;
+
+    //==============================================================================
+    const String getName() const override;
+
+    bool acceptsMidi() const override;
+    bool producesMidi() const override;
+    bool isMidiEffect() const override;
+    double getTailLengthSeconds() const override;
+
+    //==============================================================================
+    int getNumPrograms() override;
+    int getCurrentProgram() override;
+    void setCurrentProgram (int index) override;
+    const String getProgramName (int index) override;
+    void changeProgramName (int index, const String& newName) override;
+
+    //==============================================================================
+    void getStateInformation (MemoryBlock& destData) override;
+    void setStateInformation (const void* data, int sizeInBytes) override;
+
+private:
+    // Storage format switches allocate, so they are deferred to the message thread
+    void parameterChanged (const String& parameterID, float newValue) override;
+    void handleAsyncUpdate() override;
+    
+    DelayEffect delay;
+    static constexpr float maxDelaySeconds = 2.0f;
+    double hostBpm = 120.0;
+    std::atomic<double> tailLengthSeconds { 0.0 };
+    
+    static AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CircularBufferAudioProcessor)
+};
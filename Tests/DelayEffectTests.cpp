@@ -0,0 +1,595 @@
+/*
+  ==============================================================================
+
+    Console tests for DelayEffect and the processor around it.
+
+    Run with --update-golden to record the references in Golden/ from the
+    current build, after a change that is meant to alter the sound, and with
+    --benchmark to time the float and 16-bit lines instead of testing.
+    References are only ever recorded from a build against JUCE itself.
+
+  ==============================================================================
+*/
+
+#include "DelayScenarios.h"
+
+#include <thread>
+
+using namespace juce;
+
+namespace
+{
+    bool updateGolden = false;
+
+    // Only leaves room for float rounding differences between compilers and platforms
+    constexpr float goldenTolerance = 1.0e-5f;
+
+    // Every frame of the render, as little-endian 32-bit floats
+    File getGoldenFile (const String& name)
+    {
+        return File (CIRCULAR_BUFFER_GOLDEN_DIR).getChildFile (name + ".bin");
+    }
+
+    void setParameter (CircularBufferAudioProcessor& processor, const String& id, float value)
+    {
+        auto* parameter = processor.treeState.getParameter (id);
+        parameter->setValueNotifyingHost (parameter->convertTo0to1 (value));
+    }
+
+    // A host playing at a fixed tempo, or reporting none when bpm is 0
+    struct FixedTempoPlayHead : public AudioPlayHead
+    {
+        Optional<PositionInfo> getPosition() const override
+        {
+            PositionInfo position;
+            if (bpm > 0.0)
+                position.setBpm (bpm);
+
+            return position;
+        }
+
+        double bpm = 120.0;
+    };
+
+    bool isFinite (const AudioBuffer<float>& buffer)
+    {
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+                if (! std::isfinite (buffer.getSample (channel, i)))
+                    return false;
+
+        return true;
+    }
+}
+
+//==============================================================================
+class DelayEffectGoldenTests : public UnitTest
+{
+public:
+    DelayEffectGoldenTests() : UnitTest ("DelayEffect golden renders", "CircularBuffer") {}
+
+    void runTest() override
+    {
+        for (const auto& scenario : DelayScenarios::getScenarios())
+        {
+            beginTest (scenario.name);
+
+            const auto frames = DelayScenarios::render (scenario);
+            const auto file = getGoldenFile (scenario.name);
+
+            if (updateGolden)
+            {
+                MemoryOutputStream stream;
+                for (const auto sample : frames)
+                    stream.writeFloat (sample);
+
+                file.getParentDirectory().createDirectory();
+                expect (file.replaceWithData (stream.getData(), stream.getDataSize()), "Couldn't write " + file.getFullPathName());
+                continue;
+            }
+
+            if (! file.existsAsFile())
+            {
+                expect (false, "Missing reference " + file.getFullPathName() + ", record it with --update-golden");
+                continue;
+            }
+
+            MemoryBlock data;
+            file.loadFileAsData (data);
+            MemoryInputStream stream (data, false);
+
+            expectEquals ((int) data.getSize(), (int) (frames.size() * sizeof (float)), "Reference length");
+
+            float maxError = 0.0f;
+            size_t worst = 0;
+
+            for (size_t i = 0; i < frames.size() && ! stream.isExhausted(); ++i)
+            {
+                const float error = std::abs (frames[i] - stream.readFloat());
+                if (error > maxError)
+                {
+                    maxError = error;
+                    worst = i;
+                }
+            }
+
+            expectLessOrEqual (maxError, goldenTolerance,
+                               "Largest difference at sample " + String ((int) worst / 2) + ", channel " + String ((int) worst % 2));
+        }
+    }
+};
+
+//==============================================================================
+class DelayEffectStorageTests : public UnitTest
+{
+public:
+    DelayEffectStorageTests() : UnitTest ("DelayEffect storage", "CircularBuffer") {}
+
+    void runTest() override
+    {
+        beginTest ("16-bit line decays to silence");
+        {
+            // With 0.99 feedback the tail stays above the 16-bit step for a long time;
+            // -60 dB takes log(0.001) / log(0.99) = 687 repeats of 50 ms, about 34 s
+            DelayEffect delay;
+            delay.setCompactStorage (true);
+            prepare (delay, 50.0f, 0.99f);
+
+            const int numBlocks  = (int) (60.0 * sampleRate) / blockSize;
+            const int lastSecond = numBlocks - (int) sampleRate / blockSize;
+            float peak = 0.0f;
+
+            for (int block = 0; block < numBlocks; ++block)
+            {
+                const auto output = processBlock (delay, block);
+                if (block >= lastSecond)
+                    peak = jmax (peak, output);
+            }
+
+            // Nothing may keep recirculating once the tail is below one 16-bit step (1.2e-4)
+            expectLessOrEqual (peak, 1.0e-4f, "Tail is stuck in a limit cycle");
+        }
+
+        beginTest ("Switching format keeps the repeats");
+        {
+            DelayEffect reference, switched;
+            prepare (reference, 120.0f, 0.6f);
+            prepare (switched, 120.0f, 0.6f);
+
+            float maxError = 0.0f;
+
+            for (int block = 0; block < 100; ++block)
+            {
+                // Between blocks, like the processor does with processing suspended
+                if (block == 10 || block == 50)
+                    switched.setCompactStorage (block == 10);
+
+                AudioBuffer<float> expected (2, blockSize), actual (2, blockSize);
+                fillBurst (expected, block);
+                fillBurst (actual, block);
+                reference.process (expected);
+                switched.process (actual);
+
+                for (int channel = 0; channel < 2; ++channel)
+                    for (int i = 0; i < blockSize; ++i)
+                        maxError = jmax (maxError, std::abs (actual.getSample (channel, i) - expected.getSample (channel, i)));
+            }
+
+            expectLessOrEqual (maxError, 1.0e-3f);
+        }
+    }
+
+private:
+    static constexpr double sampleRate = 48000.0;
+    static constexpr int blockSize = 480;
+
+    static void prepare (DelayEffect& delay, float delayMs, float feedback)
+    {
+        delay.prepare (sampleRate, 2, 2.0f);
+        delay.setDelayTime (delayMs);
+        delay.setFeedback (feedback);
+        delay.setWet (100.0f);
+        delay.setDry (0.0f);
+        delay.setHighPassCutoff (20.0f);
+        delay.setLowPassCutoff (20000.0f);
+    }
+
+    // 50 ms of a 1 kHz tone at -6 dBFS at the start, silence afterwards
+    static void fillBurst (AudioBuffer<float>& buffer, int block)
+    {
+        for (int channel = 0; channel < 2; ++channel)
+        {
+            for (int i = 0; i < blockSize; ++i)
+            {
+                const int n = block * blockSize + i;
+                buffer.setSample (channel, i, n < (int) (0.05 * sampleRate)
+                                                  ? 0.5f * std::sin (MathConstants<float>::twoPi * 1000.0f * (float) n / (float) sampleRate)
+                                                  : 0.0f);
+            }
+        }
+    }
+
+    // Returns the output peak of the block
+    static float processBlock (DelayEffect& delay, int block)
+    {
+        AudioBuffer<float> buffer (2, blockSize);
+        fillBurst (buffer, block);
+        delay.process (buffer);
+        return buffer.getMagnitude (0, blockSize);
+    }
+};
+
+//==============================================================================
+class ProcessorTests : public UnitTest
+{
+public:
+    ProcessorTests() : UnitTest ("CircularBuffer processor", "CircularBuffer") {}
+
+    void runTest() override
+    {
+        beginTest ("Tail length matches the measured decay");
+        {
+            CircularBufferAudioProcessor processor;
+            setParameter (processor, PARAM_DELAY_TIME_ID, 100.0f);
+            setParameter (processor, PARAM_DECAY_TIME_MS_ID, 1450.0f);
+            checkTail (processor, 0.1, false);
+        }
+
+        beginTest ("Tail length follows the longer mid/side lane");
+        {
+            CircularBufferAudioProcessor processor;
+            setParameter (processor, PARAM_DELAY_TIME_ID, 100.0f);
+            setParameter (processor, PARAM_DECAY_TIME_MS_ID, 1450.0f);
+            setParameter (processor, PARAM_MID_SIDE_ID, 1.0f);
+            setParameter (processor, PARAM_SIDE_DELAY_TIME_ID, 200.0f);
+            setParameter (processor, PARAM_SIDE_DECAY_TIME_MS_ID, 2900.0f);
+            checkTail (processor, 0.2, true);
+        }
+
+        beginTest ("Freeze reports an infinite tail");
+        {
+            CircularBufferAudioProcessor processor;
+            setParameter (processor, PARAM_FREEZE_ID, 1.0f);
+            processor.prepareToPlay (48000.0, 512);
+            expect (std::isinf (processor.getTailLengthSeconds()));
+        }
+
+        beginTest ("Tempo sync follows the host tempo");
+        {
+            CircularBufferAudioProcessor processor;
+            FixedTempoPlayHead playHead;
+            processor.setPlayHead (&playHead);
+            processor.prepareToPlay (48000.0, 512);
+            setParameter (processor, PARAM_SYNC_ID, 1.0f);
+
+            checkSync (processor, playHead, {
+                { 2, 0, 120.0, 500.0 },             // 1/4
+                { 3, 1, 120.0, 375.0 },             // 1/8 dotted
+                { 2, 2, 120.0, 1000.0 / 3.0 },      // 1/4 triplet
+                { 2, 0, 90.0,  2000.0 / 3.0 },      // 1/4 at another tempo
+                { 2, 0, 0.0,   2000.0 / 3.0 },      // no tempo from the host: the last one stays
+                { 0, 0, 120.0, 95999.0 / 48.0 }     // 1/1 at 120 BPM fits, one sample short of 2 s
+            });
+
+            setParameter (processor, PARAM_SYNC_ID, 0.0f);
+            setParameter (processor, PARAM_DELAY_TIME_ID, 250.0f);
+            expectWithinAbsoluteError (processBlockAndGetDelayMs (processor), 250.0, 1000.0 / 48000.0, "Free delay time once sync is off");
+        }
+
+        beginTest ("Tempo sync steps down to a division that fits the line");
+        {
+            CircularBufferAudioProcessor processor;
+            FixedTempoPlayHead playHead;
+            processor.setPlayHead (&playHead);
+            processor.prepareToPlay (48000.0, 512);
+            setParameter (processor, PARAM_SYNC_ID, 1.0f);
+
+            // A whole note lasts 6 s at 40 BPM and 4 s at 60 BPM; the line holds 2 s
+            checkSync (processor, playHead, {
+                { 0, 0, 40.0, 1500.0 },             // 1/1 -> 1/4
+                { 1, 1, 40.0, 1125.0 },             // 1/2 dotted -> 1/8 dotted
+                { 0, 2, 60.0, 4000.0 / 3.0 },       // 1/1 triplet -> 1/2 triplet
+                { 1, 0, 60.0, 95999.0 / 48.0 }      // 1/2 fits as it is
+            });
+        }
+
+        beginTest ("Re-preparing at a lower rate while frozen");
+        {
+            // The loop engaged on the 96 kHz line is longer than the whole 44.1 kHz one
+            CircularBufferAudioProcessor processor;
+            setParameter (processor, PARAM_DELAY_TIME_ID, 1900.0f);
+            setParameter (processor, PARAM_FREEZE_ID, 1.0f);
+
+            AudioBuffer<float> buffer (2, 512);
+            MidiBuffer midi;
+            bool allFinite = true;
+
+            for (const double sampleRate : { 96000.0, 44100.0 })
+            {
+                processor.prepareToPlay (sampleRate, 512);
+
+                for (int block = 0; block < 10; ++block)
+                {
+                    buffer.clear();
+                    buffer.setSample (0, 0, 0.5f);
+                    processor.processBlock (buffer, midi);
+                    allFinite = allFinite && isFinite (buffer);
+                }
+            }
+
+            expect (allFinite, "Non-finite output");
+        }
+
+        beginTest ("State and parameter changes while processing");
+        stressStateAndParameters();
+    }
+
+private:
+    struct SyncCase
+    {
+        int division, mode;     // choice indices: 1/1 ... 1/32, straight / dotted / triplet
+        double bpm, expectedMs;
+    };
+
+    void checkSync (CircularBufferAudioProcessor& processor, FixedTempoPlayHead& playHead, std::initializer_list<SyncCase> cases)
+    {
+        for (const auto& c : cases)
+        {
+            setParameter (processor, PARAM_SYNC_DIVISION_ID, (float) c.division);
+            setParameter (processor, PARAM_SYNC_MODE_ID, (float) c.mode);
+            playHead.bpm = c.bpm;
+
+            // The delay time is rounded down to a whole number of samples
+            expectWithinAbsoluteError (processBlockAndGetDelayMs (processor), c.expectedMs, 1000.0 / 48000.0,
+                                       "Division " + String (c.division) + ", mode " + String (c.mode) + " at " + String (c.bpm) + " BPM");
+        }
+    }
+
+    // The delay time picked up by the next block
+    static double processBlockAndGetDelayMs (CircularBufferAudioProcessor& processor)
+    {
+        AudioBuffer<float> buffer (2, 512);
+        MidiBuffer midi;
+        buffer.clear();
+        processor.processBlock (buffer, midi);
+
+        return processor.getDelay().getDelayTime() * 1000.0;
+    }
+
+    // Feeds a 10 ms, 1 kHz burst through the wet path only and finds the last sample above -60 dB
+    // of it. The last repeat over the threshold lands up to one delay time before the reported tail.
+    void checkTail (CircularBufferAudioProcessor& processor, double delayTime, bool sideOnly)
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int blockSize = 512;
+        constexpr float level = 0.5f;
+
+        setParameter (processor, PARAM_WET_ID, 100.0f);
+        setParameter (processor, PARAM_DRY_ID, 0.0f);
+        processor.prepareToPlay (sampleRate, blockSize);
+
+        AudioBuffer<float> buffer (2, blockSize);
+        MidiBuffer midi;
+
+        const double reported = processor.getTailLengthSeconds();
+        const int burstLength = (int) (0.01 * sampleRate);
+        const int numSamples  = (int) ((reported + 2.0) * sampleRate);
+        int lastAudible = 0;
+
+        for (int start = 0; start < numSamples; start += blockSize)
+        {
+            buffer.clear();
+
+            for (int i = 0; i < blockSize && start + i < burstLength; ++i)
+            {
+                const float x = level * std::sin (MathConstants<float>::twoPi * 1000.0f * (float) (start + i) / (float) sampleRate);
+                buffer.setSample (0, i, x);
+                buffer.setSample (1, i, sideOnly ? -x : 0.0f);
+            }
+
+            processor.processBlock (buffer, midi);
+
+            for (int channel = 0; channel < 2; ++channel)
+                for (int i = 0; i < blockSize; ++i)
+                    if (std::abs (buffer.getSample (channel, i)) > level * 0.001f)
+                        lastAudible = start + i;
+        }
+
+        const double measured = lastAudible / sampleRate;
+
+        expectGreaterThan (reported, 0.0);
+        expectLessOrEqual (measured, reported + 0.02, "Repeats outlast the reported tail");
+        expectGreaterOrEqual (measured, reported - delayTime - 0.02, "Reported tail is too long");
+    }
+
+    // Hammers setStateInformation() and the parameters from other threads while an "audio thread"
+    // runs processBlock() the way a host does, under the callback lock. Build with
+    // CIRCULAR_BUFFER_TSAN=ON for ThreadSanitizer to check the hand-offs.
+    void stressStateAndParameters()
+    {
+        constexpr int blockSize = 256;
+
+        CircularBufferAudioProcessor processor;
+        processor.prepareToPlay (48000.0, blockSize);
+
+        MemoryBlock plainState, busyState;
+        processor.getStateInformation (plainState);
+
+        setParameter (processor, PARAM_SHIMMER_ID, 50.0f);
+        setParameter (processor, PARAM_PING_PONG_ID, 100.0f);
+        setParameter (processor, PARAM_STORAGE_ID, 1.0f);
+        setParameter (processor, PARAM_MID_SIDE_ID, 1.0f);
+        setParameter (processor, PARAM_REVERSE_ID, 1.0f);
+        processor.getStateInformation (busyState);
+
+        std::atomic<bool> running { true };
+        std::atomic<bool> allFinite { true };
+        std::atomic<int> numBlocks { 0 };
+        std::atomic<int> numWritersDone { 0 };
+
+        std::thread audioThread ([&]
+        {
+            AudioBuffer<float> buffer (2, blockSize);
+            MidiBuffer midi;
+            Random random (1);
+
+            while (running)
+            {
+                for (int channel = 0; channel < 2; ++channel)
+                    for (int i = 0; i < blockSize; ++i)
+                        buffer.setSample (channel, i, random.nextFloat() - 0.5f);
+
+                {
+                    const ScopedLock sl (processor.getCallbackLock());
+                    if (! processor.isSuspended())
+                        processor.processBlock (buffer, midi);
+                }
+
+                if (! isFinite (buffer))
+                    allFinite = false;
+
+                ++numBlocks;
+            }
+        });
+
+        std::thread stateThread ([&]
+        {
+            for (int i = 0; i < 200; ++i)
+            {
+                const auto& state = (i % 2 == 0) ? busyState : plainState;
+                processor.setStateInformation (state.getData(), (int) state.getSize());
+
+                MemoryBlock saved;
+                processor.getStateInformation (saved);
+                Thread::sleep (1);
+            }
+
+            ++numWritersDone;
+        });
+
+        std::thread parameterThread ([&]
+        {
+            Random random (2);
+            const auto& parameters = processor.getParameters();
+
+            for (int i = 0; i < 5000; ++i)
+            {
+                parameters[random.nextInt (parameters.size())]->setValueNotifyingHost (random.nextFloat());
+
+                if (i % 50 == 0)
+                    Thread::sleep (1);
+            }
+
+            ++numWritersDone;
+        });
+
+        // The message thread keeps dispatching, so updates deferred to it (storage switches) run too
+        while (numWritersDone < 2)
+            MessageManager::getInstance()->runDispatchLoopUntil (10);
+
+        stateThread.join();
+        parameterThread.join();
+        running = false;
+        audioThread.join();
+
+        expect (allFinite, "Non-finite output");
+        expectGreaterThan (numBlocks.load(), 0);
+    }
+};
+
+//==============================================================================
+// Not a test: logs the CPU cost of the float and 16-bit lines, in ns per frame
+class DelayEffectBenchmark : public UnitTest
+{
+public:
+    DelayEffectBenchmark() : UnitTest ("DelayEffect line formats", "CircularBufferBenchmark") {}
+
+    void runTest() override
+    {
+        beginTest ("Float vs 16-bit line");
+
+        for (const auto rate : { 48000.0, 192000.0 })
+            for (const int numChannels : { 2, 8 })
+                for (const bool reverse : { false, true })
+                    for (const float delayMs : { 20.0f, 1900.0f })
+                        logMessage (String (rate, 0) + " Hz, " + String (numChannels) + " ch, "
+                                    + (reverse ? "reverse " : "forward ") + String (delayMs, 0) + " ms: float "
+                                    + String (time (false, rate, numChannels, delayMs, reverse), 1) + " ns, 16-bit "
+                                    + String (time (true, rate, numChannels, delayMs, reverse), 1) + " ns");
+    }
+
+private:
+    static constexpr int blockSize = 512;
+
+    // Best of five runs over 4 s of noise
+    static double time (bool compact, double rate, int numChannels, float delayMs, bool reverse)
+    {
+        DelayEffect delay;
+        delay.setCompactStorage (compact);
+        delay.prepare (rate, numChannels, 2.0f);
+        delay.setDelayTime (delayMs);
+        delay.setFeedback (0.7f);
+        delay.setWet (50.0f);
+        delay.setDry (100.0f);
+        delay.setHighPassCutoff (100.0f);
+        delay.setLowPassCutoff (8000.0f);
+        delay.setReverse (reverse);
+
+        AudioBuffer<float> noise (numChannels, (int) rate), buffer (numChannels, blockSize);
+        Random random (1);
+        for (int channel = 0; channel < numChannels; ++channel)
+            for (int i = 0; i < noise.getNumSamples(); ++i)
+                noise.setSample (channel, i, random.nextFloat() - 0.5f);
+
+        const int numFrames = 4 * noise.getNumSamples();
+        double best = std::numeric_limits<double>::max();
+
+        for (int run = 0; run < 5; ++run)
+        {
+            const auto start = Time::getMillisecondCounterHiRes();
+
+            for (int frame = 0; frame < numFrames; frame += blockSize)
+            {
+                for (int channel = 0; channel < numChannels; ++channel)
+                    buffer.copyFrom (channel, 0, noise, channel, frame % noise.getNumSamples(), blockSize);
+
+                delay.process (buffer);
+            }
+
+            best = jmin (best, (Time::getMillisecondCounterHiRes() - start) * 1.0e6 / numFrames);
+        }
+
+        return best;
+    }
+};
+
+static DelayEffectGoldenTests delayEffectGoldenTests;
+static DelayEffectStorageTests delayEffectStorageTests;
+static ProcessorTests processorTests;
+static DelayEffectBenchmark delayEffectBenchmark;
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    ScopedJuceInitialiser_GUI juceInitialiser;
+
+    bool benchmark = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (String (argv[i]) == "--update-golden")
+            updateGolden = true;
+        else if (String (argv[i]) == "--benchmark")
+            benchmark = true;
+    }
+
+    UnitTestRunner runner;
+    runner.setAssertOnFailure (false);
+    runner.runTestsInCategory (benchmark ? "CircularBufferBenchmark" : "CircularBuffer");
+
+    int failures = 0;
+    for (int i = 0; i < runner.getNumResults(); ++i)
+        failures += runner.getResult (i)->failures;
+
+    return failures > 0 ? 1 : 0;
+}
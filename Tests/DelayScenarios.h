@@ -0,0 +1,239 @@
+/*
+  ==============================================================================
+
+    Fixed-parameter renders of DelayEffect, one per mode. DelayEffectTests
+    compares each of them, frame by frame, against its reference in Golden/<name>.bin.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "PluginProcessor.h"
+
+#include <functional>
+#include <vector>
+
+namespace DelayScenarios
+{
+    constexpr double sampleRate   = 48000.0;
+    constexpr int blockSize       = 480;
+    constexpr int numBlocks       = 100;    // one second
+
+    struct Scenario
+    {
+        const char* name;
+        std::function<void (DelayEffect&, int block)> configure;   // called before every block
+        bool useSidechain = false;
+    };
+
+    // 100 ms of two tones (one per channel), then silence for the repeats to play out
+    inline float input (int channel, int sample)
+    {
+        if (sample >= (int)(0.1 * sampleRate))
+            return 0.0f;
+
+        const double t = sample / sampleRate;
+        return channel == 0 ? (float)(0.5 * std::sin(MathConstants<double>::twoPi * 440.0 * t))
+                            : (float)(0.3 * std::sin(MathConstants<double>::twoPi * 660.0 * t));
+    }
+
+    // A 50 ms, 150 Hz pulse every 250 ms on both channels
+    inline float sidechainInput (int sample)
+    {
+        const int period = (int)(0.25 * sampleRate);
+        if (sample % period >= (int)(0.05 * sampleRate))
+            return 0.0f;
+
+        return (float)(0.5 * std::sin(MathConstants<double>::twoPi * 150.0 * sample / sampleRate));
+    }
+
+    inline void setDefaults (DelayEffect& delay)
+    {
+        delay.setDelayTime(120.0f);
+        delay.setFeedback(0.6f);
+        delay.setWet(50.0f);
+        delay.setDry(100.0f);
+        delay.setHighPassCutoff(100.0f);
+        delay.setLowPassCutoff(8000.0f);
+    }
+
+    inline std::vector<Scenario> getScenarios()
+    {
+        return {
+            { "plain", [] (DelayEffect& d, int) { setDefaults(d); } },
+
+            { "retime", [] (DelayEffect& d, int block)
+                {
+                    setDefaults(d);
+                    d.setDelayTime(block < 40 ? 120.0f : 250.0f);
+                } },
+
+            { "shimmer_octave_up", [] (DelayEffect& d, int)
+                {
+                    setDefaults(d);
+                    d.setShimmer(60.0f);
+                    d.setShimmerPitch(12.0f);
+                } },
+
+            { "shimmer_fifth_down", [] (DelayEffect& d, int)
+                {
+                    setDefaults(d);
+                    d.setShimmer(60.0f);
+                    d.setShimmerPitch(-7.0f);
+                } },
+
+            { "ping_pong", [] (DelayEffect& d, int)
+                {
+                    setDefaults(d);
+                    d.setPingPong(100.0f);
+                } },
+
+            { "rotation_width", [] (DelayEffect& d, int)
+                {
+                    setDefaults(d);
+                    d.setRotation(45.0f);
+                    d.setWidth(40.0f);
+                } },
+
+            { "compact_storage", [] (DelayEffect& d, int)
+                {
+                    setDefaults(d);
+                    d.setCompactStorage(true);
+                } },
+
+            { "duck_input", [] (DelayEffect& d, int)
+                {
+                    setDefaults(d);
+                    d.setDuck(80.0f);
+                    d.setDuckAttack(5.0f);
+                    d.setDuckRelease(100.0f);
+                } },
+
+            { "duck_sidechain", [] (DelayEffect& d, int)
+                {
+                    setDefaults(d);
+                    d.setDuck(80.0f);
+                    d.setDuckAttack(5.0f);
+                    d.setDuckRelease(100.0f);
+                }, true },
+
+            { "duck_rms", [] (DelayEffect& d, int)
+                {
+                    setDefaults(d);
+                    d.setDuck(80.0f);
+                    d.setDuckAttack(5.0f);
+                    d.setDuckRelease(100.0f);
+                    d.setDuckRms(true);
+                } },
+
+            { "freeze", [] (DelayEffect& d, int block)
+                {
+                    setDefaults(d);
+                    d.setDelayTime(150.0f);
+                    d.setFreeze(block >= 30 && block < 80);
+                } },
+
+            { "freeze_duck", [] (DelayEffect& d, int block)
+                {
+                    setDefaults(d);
+                    d.setDelayTime(150.0f);
+                    d.setDuck(80.0f);
+                    d.setDuckAttack(5.0f);
+                    d.setDuckRelease(100.0f);
+                    d.setFreeze(block >= 30 && block < 80);
+                }, true },
+
+            { "mid_side", [] (DelayEffect& d, int)
+                {
+                    setDefaults(d);
+                    d.setMidSide(true);
+                    d.setSideDelayTime(200.0f);
+                    d.setSideFeedback(0.4f);
+                    d.setSideHighPassCutoff(300.0f);
+                    d.setSideLowPassCutoff(3000.0f);
+                } },
+
+            { "mid_side_toggle", [] (DelayEffect& d, int block)
+                {
+                    setDefaults(d);
+                    d.setMidSide(block >= 20 && block < 60);
+                    d.setSideDelayTime(120.0f);
+                    d.setSideFeedback(0.6f);
+                    d.setSideHighPassCutoff(100.0f);
+                    d.setSideLowPassCutoff(8000.0f);
+                } },
+
+            { "reverse", [] (DelayEffect& d, int)
+                {
+                    setDefaults(d);
+                    d.setReverse(true);
+                } },
+
+            { "reverse_retime", [] (DelayEffect& d, int block)
+                {
+                    setDefaults(d);
+                    d.setReverse(true);
+                    d.setDelayTime(block < 40 ? 120.0f : 250.0f);
+                } },
+
+            { "reverse_toggle", [] (DelayEffect& d, int block)
+                {
+                    setDefaults(d);
+                    d.setReverse(block >= 25 && block < 60);
+                } },
+
+            { "tape_stop", [] (DelayEffect& d, int block)
+                {
+                    setDefaults(d);
+                    d.setTapeStopTime(300.0f);
+                    d.setTapeStop(block >= 30 && block < 70);
+                } },
+
+            { "tape_stop_shimmer", [] (DelayEffect& d, int block)
+                {
+                    setDefaults(d);
+                    d.setShimmer(60.0f);
+                    d.setShimmerPitch(12.0f);
+                    d.setTapeStopTime(300.0f);
+                    d.setTapeStop(block >= 30 && block < 70);
+                } },
+        };
+    }
+
+    // Renders one scenario in stereo, returning every frame as a left/right pair
+    inline std::vector<float> render (const Scenario& scenario)
+    {
+        DelayEffect delay;
+        delay.prepare(sampleRate, 2, 2.0f);
+
+        AudioBuffer<float> buffer (2, blockSize);
+        AudioBuffer<float> sidechain (2, blockSize);
+        std::vector<float> frames;
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            const int start = block * blockSize;
+            scenario.configure(delay, block);
+
+            for (int channel = 0; channel < 2; ++channel)
+            {
+                for (int i = 0; i < blockSize; ++i)
+                {
+                    buffer.getWritePointer(channel)[i]    = input(channel, start + i);
+                    sidechain.getWritePointer(channel)[i] = sidechainInput(start + i);
+                }
+            }
+
+            delay.process(buffer, scenario.useSidechain ? &sidechain : nullptr);
+
+            for (int i = 0; i < blockSize; ++i)
+            {
+                frames.push_back(buffer.getReadPointer(0)[i]);
+                frames.push_back(buffer.getReadPointer(1)[i]);
+            }
+        }
+
+        return frames;
+    }
+}
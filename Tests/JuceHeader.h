@@ -0,0 +1,15 @@
+/*
+  ==============================================================================
+
+    Stand-in for the Projucer-generated JuceHeader.h, so the plugin sources
+    build in the test target with only the modules it links.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include <juce_dsp/juce_dsp.h>
+
+#include "BinaryData.h"